@@ -6,143 +6,182 @@
 /* Kenneth C. Louden                                */
 /****************************************************/
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include "globals.h"
 #include "symtab.h"
 #include "analyze.h"
 #include "util.h"
+#include "atom.h"
+#include "traverse.h"
+#include "parse.h"
 
 /* counter for variable memory locations */
 static int location = 0;
 
-ScopeList globalScope = NULL;
-char *curFuncName = NULL;
-int isFuncScopeCreated = FALSE;
+_Thread_local ScopeList globalScope = NULL;
+_Thread_local char *curFuncName = NULL;
+_Thread_local int isFuncScopeCreated = FALSE;
+
+/* A GlobalUse is a use of a global entry found by
+ * an analysis thread, recorded when the threads are
+ * done so that each entry lists its uses in order
+ */
+typedef struct
+{
+  BucketList entry;
+  int lineno;
+  int column;
+} GlobalUse;
+
+/* A Dependency is a global name a function's body
+ * looked up, with what the global scope gave
+ */
+typedef struct
+{
+  char *name;
+  unsigned int signature; /* of the entry, 0 if none */
+} Dependency;
+
+/* A Worker is a thread of analyzeParallel, or the
+ * main thread's part in it, or the main thread
+ * analyzing changed bodies in analyzeIncremental.
+ * Its diagnostics go to its own streams, its scopes
+ * and entries to its own arena
+ */
+typedef struct
+{
+  pthread_t thread;
+  struct BatchRec *batch; /* of analyzeParallel's threads */
+  FILE *insertOut, *checkOut;
+  char *insertText, *checkText;
+  size_t insertSize, checkSize;
+  FILE *listingOut; /* the listing of its scopes, if kept */
+  char *listingText;
+  size_t listingSize;
+  Arena arena;
+  ScopeList *scopes; /* taken when it is done */
+  int scopeCount;
+  GlobalUse *uses; /* with xrefIndex */
+  int useCount, useCapacity;
+  Dependency *deps; /* with recording */
+  int depCount, depCapacity;
+  int recording;
+  int error; /* a diagnostic was given */
+} Worker;
+
+/* the calling thread's Worker, NULL outside
+ * analyzeParallel's threads and changed bodies
+ */
+static _Thread_local Worker *worker = NULL;
+
+/* where the calling thread's diagnostics go */
+static _Thread_local FILE *diagnostics;
+
+/* noteError sets Error, or the error flag of the
+ * calling analysis thread
+ */
+static void noteError(void)
+{
+  if (worker != NULL)
+    worker->error = TRUE;
+  else
+    Error = TRUE;
+}
 
 void undeclaredFunctionError(TreeNode *treeNode)
 {
-  fprintf(listing, "Error: undeclared function \"%s\" is called at line %d\n", treeNode->name, treeNode->lineno);
-  Error = TRUE;
+  fprintf(diagnostics, "Error: undeclared function \"%s\" is called at line %d\n", treeNode->name, treeNode->lineno);
+  noteError();
 }
 
 void undeclaredVariableError(TreeNode *treeNode)
 {
-  fprintf(listing, "Error: undeclared variable \"%s\" is used at line %d\n", treeNode->name, treeNode->lineno);
-  Error = TRUE;
+  fprintf(diagnostics, "Error: undeclared variable \"%s\" is used at line %d\n", treeNode->name, treeNode->lineno);
+  noteError();
 }
 
 void voidTypeError(TreeNode *treeNode)
 {
-  fprintf(listing, "Error: The void-type variable is declared at line %d (name : \"%s\")\n", treeNode->lineno, treeNode->name);
-  Error = TRUE;
+  fprintf(diagnostics, "Error: The void-type variable is declared at line %d (name : \"%s\")\n", treeNode->lineno, treeNode->name);
+  noteError();
 }
 
 void invalidArrayIndexingIntError(TreeNode *treeNode)
 {
-  fprintf(listing, "Error: Invalid array indexing at line %d (name : \"%s\"). indicies should be integer\n", treeNode->lineno, treeNode->name);
-  Error = TRUE;
+  fprintf(diagnostics, "Error: Invalid array indexing at line %d (name : \"%s\"). indicies should be integer\n", treeNode->lineno, treeNode->name);
+  noteError();
 }
 
 void invalidArrayIndexingNotArrayError(TreeNode *treeNode)
 {
-  fprintf(listing, "Error: Invalid array indexing at line %d (name : \"%s\"). indexing can only allowed for int[] variables\n", treeNode->lineno, treeNode->name);
-  Error = TRUE;
+  fprintf(diagnostics, "Error: Invalid array indexing at line %d (name : \"%s\"). indexing can only allowed for int[] variables\n", treeNode->lineno, treeNode->name);
+  noteError();
 }
 
 void invalidFunctionCallError(TreeNode *treeNode)
 {
-  fprintf(listing, "Error: Invalid function call at line %d (name : \"%s\")\n", treeNode->lineno, treeNode->name);
-  Error = TRUE;
+  fprintf(diagnostics, "Error: Invalid function call at line %d (name : \"%s\")\n", treeNode->lineno, treeNode->name);
+  noteError();
 }
 
 void invalidReturnError(TreeNode *treeNode)
 {
-  fprintf(listing, "Error: Invalid return at line %d\n", treeNode->lineno);
-  Error = TRUE;
+  fprintf(diagnostics, "Error: Invalid return at line %d\n", treeNode->lineno);
+  noteError();
 }
 
 void invalidAssignmentError(TreeNode *treeNode)
 {
-  fprintf(listing, "Error: invalid assignment at line %d\n", treeNode->lineno);
-  Error = TRUE;
+  fprintf(diagnostics, "Error: invalid assignment at line %d\n", treeNode->lineno);
+  noteError();
 }
 
 void invalidOperationError(TreeNode *treeNode)
 {
-  fprintf(listing, "Error: invalid operation at line %d\n", treeNode->lineno);
-  Error = TRUE;
+  fprintf(diagnostics, "Error: invalid operation at line %d\n", treeNode->lineno);
+  noteError();
 }
 
 void invalidConditionError(TreeNode *treeNode)
 {
-  fprintf(listing, "Error: invalid condition at line %d\n", treeNode->lineno);
-  Error = TRUE;
+  fprintf(diagnostics, "Error: invalid condition at line %d\n", treeNode->lineno);
+  noteError();
 }
 
 void redefinedSymbolError(TreeNode *treeNode, BucketList l)
 {
-  fprintf(listing, "Error: Symbol \"%s\" is redefined at line %d (already defined at line ", treeNode->name, treeNode->lineno);
-  LineList t = l->lines;
-  while (t != NULL)
-  {
-    fprintf(listing, "%d ", t->lineno);
-    t = t->next;
-  }
-  fprintf(listing, ")\n");
-  Error = TRUE;
+  fprintf(diagnostics, "Error: Symbol \"%s\" is redefined at line %d (already defined at line ", treeNode->name, treeNode->lineno);
+  st_print_lines(diagnostics, l, "%d ");
+  fprintf(diagnostics, ")\n");
+  noteError();
 }
 
 void push_built_in_functions()
 {
-  TreeNode *inputNode = newTreeNode(FunDeclK);
+  TreeNode *inputNode = allocTreeNode(&symtabArena, FunDeclK);
   inputNode->lineno = 0;
   inputNode->type = Int;
-  inputNode->name = "input";
-  inputNode->child[0] = newTreeNode(ParamK);
+  inputNode->name = intern("input");
+  inputNode->child[0] = allocTreeNode(&symtabArena, ParamK);
   inputNode->child[0]->type = Void;
-  st_insert("input", 0, addLocation(), inputNode);
+  st_insert(inputNode->name, 0, addLocation(), inputNode);
 
-  TreeNode *outputNode = newTreeNode(FunDeclK);
+  TreeNode *outputNode = allocTreeNode(&symtabArena, FunDeclK);
   outputNode->lineno = 0;
   outputNode->type = Void;
-  outputNode->name = "output";
-  TreeNode *param = newTreeNode(ParamK);
+  outputNode->name = intern("output");
+  TreeNode *param = allocTreeNode(&symtabArena, ParamK);
   param->type = Int;
-  param->name = "value";
+  param->name = intern("value");
   outputNode->child[0] = param;
-  st_insert("output", 0, addLocation(), outputNode);
-  ScopeList scope = create_scope("output");
+  st_insert(outputNode->name, 0, addLocation(), outputNode);
+  ScopeList scope = create_scope(outputNode->name);
   push_scope(scope);
-  st_insert("value", 0, addLocation(), param);
+  st_insert(param->name, 0, addLocation(), param);
   pop_scope();
 }
 
-/* Procedure traverse is a generic recursive
- * syntax tree traversal routine:
- * it applies preProc in preorder and postProc
- * in postorder to tree pointed to by t
- */
-static void
-traverse(TreeNode *t,
-         void (*preProc)(TreeNode *),
-         void (*postProc)(TreeNode *))
-{
-  if (t != NULL)
-  {
-    // printf("nodekind: %d\n", t->nodekind);
-    // printf("name: %s\n", t->name);
-    // printf("type: %d\n", t->type);
-    // printf("lineno: %d\n\n", t->lineno);
-    preProc(t);
-    {
-      int i;
-      for (i = 0; i < MAXCHILDREN; i++)
-        traverse(t->child[i], preProc, postProc);
-    }
-    postProc(t);
-    traverse(t->sibling, preProc, postProc);
-  }
-}
-
 /* nullProc is a do-nothing procedure to
  * generate preorder-only or postorder-only
  * traversals from traverse
@@ -161,12 +200,105 @@ void postProcInsertNode(TreeNode *treeNode)
     pop_scope();
 }
 
+/* Procedure bindName records in t the entry its
+ * name resolved to
+ */
+static void bindName(TreeNode *t, BucketList l)
+{
+  t->bind = l;
+}
+
+/* addUse records the use t of entry for the
+ * cross-reference index; an analysis thread keeps
+ * the uses of global entries for later
+ */
+static void addUse(BucketList entry, TreeNode *t)
+{
+  GlobalUse *use;
+  if (worker == NULL || entry->scope != globalScope)
+  {
+    st_add_use(entry, t->lineno, t->column);
+    return;
+  }
+  if (worker->useCount == worker->useCapacity)
+  {
+    worker->useCapacity = worker->useCapacity ? 2 * worker->useCapacity : 256;
+    worker->uses = (GlobalUse *)realloc(worker->uses, worker->useCapacity * sizeof(GlobalUse));
+    if (worker->uses == NULL)
+    {
+      fprintf(stderr, "Out of memory in analyzer\n");
+      exit(1);
+    }
+  }
+  use = &worker->uses[worker->useCount++];
+  use->entry = entry;
+  use->lineno = t->lineno;
+  use->column = t->column;
+}
+
+/* signature returns what a body's analysis can read
+ * from the global entry l: its kind, type, location
+ * and a function's parameter types; 0 for no entry
+ */
+static unsigned int signature(BucketList l)
+{
+  unsigned int h = 2166136261u;
+  TreeNode *p;
+  if (l == NULL)
+    return 0;
+  h = (h ^ l->treeNode->nodekind) * 16777619u;
+  h = (h ^ l->treeNode->type) * 16777619u;
+  h = (h ^ l->memloc) * 16777619u;
+  if (l->treeNode->nodekind == FunDeclK)
+    for (p = l->treeNode->child[0]; p != NULL; p = p->sibling)
+      h = (h ^ p->type) * 16777619u;
+  return h | 1;
+}
+
+/* dependencyMark[id] is markEpoch once the atom id
+ * is a dependency of the body being recorded
+ */
+static _Thread_local int *dependencyMark = NULL;
+static _Thread_local int markSize = 0;
+static _Thread_local int markEpoch = 0;
+
+/* lookupName looks name up; a worker that records
+ * dependencies notes the names resolved by the
+ * global scope, or by no scope
+ */
+static BucketList lookupName(char *name)
+{
+  BucketList l = st_lookup_return_bucket(name);
+  int id;
+  if (worker == NULL || !worker->recording || (l != NULL && l->scope != globalScope))
+    return l;
+  id = atomOf(name)->id;
+  if (dependencyMark[id] == markEpoch)
+    return l;
+  dependencyMark[id] = markEpoch;
+  if (worker->depCount == worker->depCapacity)
+  {
+    worker->depCapacity = worker->depCapacity ? 2 * worker->depCapacity : 256;
+    worker->deps = (Dependency *)realloc(worker->deps, worker->depCapacity * sizeof(Dependency));
+    if (worker->deps == NULL)
+    {
+      fprintf(stderr, "Out of memory in analyzer\n");
+      exit(1);
+    }
+  }
+  worker->deps[worker->depCount].name = name;
+  worker->deps[worker->depCount].signature = signature(l);
+  worker->depCount++;
+  return l;
+}
+
 /* Procedure insertNode inserts
  * identifiers stored in t into
  * the symbol table
  */
 static void insertNode(TreeNode *t)
 {
+  BucketList entry;
   switch (t->nodekind)
   {
   case VarDeclK:
@@ -187,6 +319,8 @@ static void insertNode(TreeNode *t)
     break;
 
   case FunDeclK:
+    if (t->body != 0)
+      parseBody(t);
     curFuncName = t->name;
     if (st_lookup_current_scope(t->name) != -1)
     {
@@ -215,7 +349,8 @@ static void insertNode(TreeNode *t)
     else
     {
       st_insert(t->name, t->lineno, addLocation(), t);
-      if (t->child[0] != NULL)
+      /* (set before for a global function's parameters) */
+      if (t->child[0] != NULL && t->type != IntArray)
         t->type = IntArray;
     }
     break;
@@ -232,33 +367,52 @@ static void insertNode(TreeNode *t)
     break;
 
   case CallK:
-    if (st_lookup(t->name) == -1)
+    entry = lookupName(t->name);
+    if (entry == NULL)
     {
-      TreeNode *newUndeclaredNode = newTreeNode(FunDeclK);
+      TreeNode *newUndeclaredNode = allocTreeNode(get_top_scope()->arena, FunDeclK);
       newUndeclaredNode->lineno = t->lineno;
+      newUndeclaredNode->column = t->column;
       newUndeclaredNode->name = t->name;
       newUndeclaredNode->type = Undetermined;
-      newUndeclaredNode->child[0] = newTreeNode(ParamK);
+      newUndeclaredNode->child[0] = allocTreeNode(get_top_scope()->arena, ParamK);
       newUndeclaredNode->child[0]->type = Undetermined;
       st_insert(t->name, t->lineno, addLocation(), newUndeclaredNode);
+      entry = st_lookup_return_bucket(t->name);
       undeclaredFunctionError(t);
     }
     else
       st_insert_lineno(t->name, t->lineno);
+    bindName(t, entry);
+    if (xrefIndex)
+      addUse(entry, t);
     break;
 
   case VarExpK:
-    if (st_lookup(t->name) == -1)
+    entry = lookupName(t->name);
+    if (entry == NULL)
     {
-      TreeNode *newUndeclaredNode = newTreeNode(VarDeclK);
+      TreeNode *newUndeclaredNode = allocTreeNode(get_top_scope()->arena, VarDeclK);
       newUndeclaredNode->lineno = t->lineno;
+      newUndeclaredNode->column = t->column;
       newUndeclaredNode->name = t->name;
       newUndeclaredNode->type = Undetermined;
       st_insert(t->name, t->lineno, addLocation(), newUndeclaredNode);
+      entry = st_lookup_return_bucket(t->name);
       undeclaredVariableError(t);
     }
     else
       st_insert_lineno(t->name, t->lineno);
+    bindName(t, entry);
+    if (xrefIndex)
+      addUse(entry, t);
+    break;
+
+  case RetStmtK:
+    /* the function's name as seen from the return,
+     * which a local of the same name hides
+     */
+    bindName(t, lookupName(curFuncName));
     break;
 
   default:
@@ -271,6 +425,7 @@ static void insertNode(TreeNode *t)
  */
 void buildSymtab(TreeNode *syntaxTree)
 {
+  diagnostics = listing;
   globalScope = create_scope("global");
   push_scope(globalScope);
   push_built_in_functions();
@@ -286,17 +441,14 @@ void buildSymtab(TreeNode *syntaxTree)
 
 static void typeError(TreeNode *t, char *message)
 {
-  fprintf(listing, "Type error at line %d: %s\n", t->lineno, message);
-  Error = TRUE;
+  fprintf(diagnostics, "Type error at line %d: %s\n", t->lineno, message);
+  noteError();
 }
 
 void preProcCheckNode(TreeNode *treeNode)
 {
   if (treeNode->nodekind == CompStmtK)
     push_scope(treeNode->scope);
-
-  else if (treeNode->nodekind == FunDeclK)
-    curFuncName = treeNode->name;
 }
 
 /* Procedure checkNode performs
@@ -317,7 +469,7 @@ static void checkNode(TreeNode *t)
 
   case RetStmtK:
   {
-    TreeNode *funcNode = st_lookup_return_bucket(curFuncName)->treeNode;
+    TreeNode *funcNode = t->bind->treeNode;
     if (funcNode->type == Void && t->child[0] != NULL)
       invalidReturnError(t);
     else if (funcNode->type != Void && t->child[0] == NULL)
@@ -328,6 +480,9 @@ static void checkNode(TreeNode *t)
   }
 
   case AssignK:
+    /* the target's binding, for later passes */
+    if (t->child[0] != NULL)
+      t->bind = t->child[0]->bind;
     if (t->child[0] == NULL || t->child[1] == NULL || t->child[0]->type == Undetermined || t->child[1]->type == Undetermined)
       invalidAssignmentError(t);
     else if (t->child[0]->type == Void || t->child[1]->type == Void)
@@ -353,8 +508,7 @@ static void checkNode(TreeNode *t)
 
   case CallK:
   {
-    BucketList l = st_lookup_return_bucket(t->name);
-    TreeNode *funcNode = l->treeNode;
+    TreeNode *funcNode = t->bind->treeNode;
     TreeNode *param = funcNode->child[0];
     TreeNode *arg = t->child[0];
     int errorFlag = FALSE;
@@ -388,25 +542,24 @@ static void checkNode(TreeNode *t)
 
   case VarExpK:
   {
-    if (st_lookup(t->name) == -1)
+    NodeType declared;
+    if (t->bind == NULL)
       undeclaredVariableError(t);
 
-    BucketList l = st_lookup_return_bucket(t->name);
-    TreeNode *varNode = l->treeNode;
-
-    if (varNode->type == Void || varNode->type == VoidArray)
+    declared = t->bind != NULL ? t->bind->treeNode->type : Undetermined;
+    if (declared == Void || declared == VoidArray)
       voidTypeError(t);
 
     if (t->child[0] != NULL)
     {
       if (t->child[0]->type != Int)
         invalidArrayIndexingIntError(t);
-      if (varNode->type != IntArray)
+      if (declared != IntArray)
         invalidArrayIndexingNotArrayError(t);
       t->type = Int;
     }
     else
-      t->type = varNode->type;
+      t->type = declared;
     break;
   }
 
@@ -424,7 +577,913 @@ static void checkNode(TreeNode *t)
  */
 void typeCheck(TreeNode *syntaxTree)
 {
+  diagnostics = listing;
   push_scope(globalScope);
   traverse(syntaxTree, preProcCheckNode, checkNode);
   pop_scope();
 }
+
+/* checkListing receives the diagnostics of checkNode
+ * during a fused traversal, so that they can follow
+ * those of insertNode as with two traversals
+ */
+static _Thread_local FILE *checkListing;
+
+static void fusedCheckNode(TreeNode *t)
+{
+  FILE *out = diagnostics;
+  diagnostics = checkListing;
+  checkNode(t);
+  diagnostics = out;
+}
+
+/* fusedTraverse inserts each node in preorder and
+ * checks it in postorder, where each use has its
+ * entry from insertion. The check diagnostics are
+ * returned in a malloc'ed buffer
+ */
+static void fusedTraverse(TreeNode *t, char **checkText, size_t *checkSize)
+{
+  checkListing = open_memstream(checkText, checkSize);
+  if (checkListing == NULL)
+  {
+    fprintf(stderr, "Out of memory in analyzer\n");
+    exit(1);
+  }
+  traverse(t, insertNode, fusedCheckNode);
+  fclose(checkListing);
+}
+
+void analyze(TreeNode *syntaxTree)
+{
+  char *checkText;
+  size_t checkSize;
+  diagnostics = listing;
+  globalScope = create_scope("global");
+  push_scope(globalScope);
+  push_built_in_functions();
+  fusedTraverse(syntaxTree, &checkText, &checkSize);
+  pop_scope();
+
+  if (TraceAnalyze)
+  {
+    printSymTab(listing);
+    fprintf(listing, "\nChecking Types...\n");
+  }
+  fwrite(checkText, 1, checkSize, listing);
+  free(checkText);
+}
+
+/* A CachedFunction is the analysis of a function's
+ * body kept from one build to the next: valid while
+ * the function's syntax tree hashes the same and its
+ * dependencies find the same global entries
+ */
+typedef struct CachedFunction
+{
+  unsigned long long hash;
+  Dependency *deps;
+  int depCount;
+  char *insertText, *checkText, *listingText;
+  size_t insertSize, checkSize, listingSize;
+  int lineno; /* of the function, for the line numbers in the texts */
+  int error;
+  int generation; /* of the last build that had it */
+} CachedFunction;
+
+/* the cache, by atom id of the function's name */
+static _Thread_local CachedFunction **cache = NULL;
+static _Thread_local int cacheSize = 0;
+static _Thread_local int cacheGeneration = 0;
+
+/* A Declaration is a top-level declaration in
+ * parallel or incremental analysis: where its
+ * diagnostics, scopes and uses of global entries
+ * went. A function's body is analyzed by a worker;
+ * the diagnostics of parsing it come first, from the
+ * main thread
+ */
+typedef struct
+{
+  TreeNode *t;
+  int worker;
+  int limit; /* global locations its body sees */
+  long parseStart, parseEnd; /* in the main thread's insertOut */
+  long insertStart, insertEnd;
+  long checkStart, checkEnd;
+  long listingStart, listingEnd;
+  int firstScope, scopeCount;
+  int firstUse, useCount;
+  int firstDep, depCount;
+  int error;
+  unsigned long long hash;
+  CachedFunction *cached; /* reused instead */
+} Declaration;
+
+static _Thread_local Declaration *declarations;
+static _Thread_local int declarationCount;
+static _Thread_local Worker *workers;
+
+/* A Batch is what the threads of analyzeParallel
+ * take from the calling thread, whose state is its
+ * own: they set theirs from it when they start
+ */
+typedef struct BatchRec
+{
+  Declaration *declarations;
+  int declarationCount;
+  Worker *workers;
+  ScopeList globalScope;
+  int xrefIndex;
+  atomic_int nextDeclaration;
+} Batch;
+
+/* analyzeNode analyzes a declaration as the fused
+ * traversal does, without its siblings
+ */
+static void analyzeNode(TreeNode *t)
+{
+  int i;
+  insertNode(t);
+  for (i = 0; i < MAXCHILDREN; i++)
+    traverse(t->child[i], insertNode, fusedCheckNode);
+  fusedCheckNode(t);
+}
+
+/* declareParams gives the parameters of a global
+ * function the types insertNode would, before any
+ * body that calls it is checked
+ */
+static void declareParams(TreeNode *fun)
+{
+  TreeNode *p, *q;
+  for (p = fun->child[0]; p != NULL; p = p->sibling)
+  {
+    if (p->nodekind != ParamK || p->type == Void || p->child[0] == NULL)
+      continue;
+    /* a redefined parameter keeps its type */
+    for (q = fun->child[0]; q != p; q = q->sibling)
+      if (q->nodekind == ParamK && q->type != Void && q->name == p->name)
+        break;
+    if (q == p)
+      p->type = IntArray;
+  }
+}
+
+/* analyzeBody analyzes the parameters and body of a
+ * function in a scope of its own, with the global
+ * scope as it was after the function's entry
+ */
+static void analyzeBody(Declaration *d)
+{
+  TreeNode *t = d->t;
+  int i;
+  curFuncName = t->name;
+  limit_scope(globalScope, d->limit);
+  push_scope(globalScope);
+  push_scope(create_scope(t->name));
+  isFuncScopeCreated = TRUE;
+  for (i = 0; i < MAXCHILDREN; i++)
+    traverse(t->child[i], insertNode, fusedCheckNode);
+  fusedCheckNode(t);
+  while (get_top_scope() != globalScope)
+    pop_scope();
+  pop_scope();
+}
+
+/* analysisThread takes the functions one by one, in
+ * order, and analyzes their bodies
+ */
+static void *analysisThread(void *arg)
+{
+  Worker *w = (Worker *)arg;
+  Batch *batch = w->batch;
+  declarations = batch->declarations;
+  declarationCount = batch->declarationCount;
+  workers = batch->workers;
+  globalScope = batch->globalScope;
+  xrefIndex = batch->xrefIndex;
+  worker = w;
+  scopeArena = &w->arena;
+  diagnostics = w->insertOut;
+  checkListing = w->checkOut;
+  for (;;)
+  {
+    int i = atomic_fetch_add(&batch->nextDeclaration, 1);
+    Declaration *d;
+    if (i >= declarationCount)
+      break;
+    d = &declarations[i];
+    if (d->t->nodekind != FunDeclK)
+      continue;
+    d->worker = w - workers;
+    d->insertStart = ftell(w->insertOut);
+    d->checkStart = ftell(w->checkOut);
+    d->firstScope = scope_count();
+    d->firstUse = w->useCount;
+    analyzeBody(d);
+    d->insertEnd = ftell(w->insertOut);
+    d->checkEnd = ftell(w->checkOut);
+    d->scopeCount = scope_count() - d->firstScope;
+    d->useCount = w->useCount - d->firstUse;
+  }
+  w->scopes = take_scopes(&w->scopeCount);
+  return NULL;
+}
+
+/* distinctGlobals returns TRUE if no global name,
+ * built-in ones included, is declared twice
+ */
+static int distinctGlobals(TreeNode *t)
+{
+  int input = atomOf(intern("input"))->id;
+  int output = atomOf(intern("output"))->id;
+  char *seen = (char *)calloc(atomCount() + 1, 1);
+  int distinct = TRUE;
+  if (seen == NULL)
+    return FALSE;
+  seen[input] = seen[output] = TRUE;
+  for (; t != NULL && distinct; t = t->sibling)
+  {
+    int id = atomOf(t->name)->id;
+    distinct = !seen[id];
+    seen[id] = TRUE;
+  }
+  free(seen);
+  return distinct;
+}
+
+/* startDeclarations makes the declarations of
+ * syntaxTree and count workers with open streams
+ */
+static void startDeclarations(TreeNode *syntaxTree, int count)
+{
+  TreeNode *t;
+  int i;
+  declarationCount = 0;
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    declarationCount++;
+  declarations = (Declaration *)calloc(declarationCount, sizeof(Declaration));
+  workers = (Worker *)calloc(count, sizeof(Worker));
+  if (declarations == NULL || workers == NULL)
+  {
+    fprintf(stderr, "Out of memory in analyzer\n");
+    exit(1);
+  }
+  for (i = 0, t = syntaxTree; t != NULL; i++, t = t->sibling)
+    declarations[i].t = t;
+  for (i = 0; i < count; i++)
+  {
+    Worker *w = &workers[i];
+    w->arena = (Arena)ARENA_INIT("symbol table");
+    w->insertOut = open_memstream(&w->insertText, &w->insertSize);
+    w->checkOut = open_memstream(&w->checkText, &w->checkSize);
+    w->listingOut = open_memstream(&w->listingText, &w->listingSize);
+    if (w->insertOut == NULL || w->checkOut == NULL || w->listingOut == NULL)
+    {
+      fprintf(stderr, "Out of memory in analyzer\n");
+      exit(1);
+    }
+  }
+}
+
+/* enterGlobals opens the global scope and enters the
+ * declarations in order, on the main thread with the
+ * streams of workers[mainIndex]: global variables
+ * are analyzed, functions entered and their bodies
+ * parsed
+ */
+static void enterGlobals(int mainIndex)
+{
+  Worker *mainWorker = &workers[mainIndex];
+  int i;
+  diagnostics = mainWorker->insertOut;
+  checkListing = mainWorker->checkOut;
+  globalScope = create_scope("global");
+  push_scope(globalScope);
+  push_built_in_functions();
+  for (i = 0; i < declarationCount; i++)
+  {
+    Declaration *d = &declarations[i];
+    TreeNode *t = d->t;
+    if (t->nodekind == FunDeclK)
+    {
+      FILE *out = listing;
+      listing = mainWorker->insertOut;
+      d->parseStart = ftell(mainWorker->insertOut);
+      if (t->body != 0)
+        parseBody(t);
+      d->parseEnd = ftell(mainWorker->insertOut);
+      listing = out;
+      d->limit = addLocation();
+      st_insert(t->name, t->lineno, d->limit++, t);
+      declareParams(t);
+    }
+    else
+    {
+      d->worker = mainIndex;
+      d->insertStart = ftell(mainWorker->insertOut);
+      d->checkStart = ftell(mainWorker->checkOut);
+      analyzeNode(t);
+      d->insertEnd = ftell(mainWorker->insertOut);
+      d->checkEnd = ftell(mainWorker->checkOut);
+    }
+  }
+}
+
+/* endDeclarations releases the declarations and
+ * count workers, keeping their arenas' memory in
+ * symtabArena
+ */
+static void endDeclarations(int count)
+{
+  int i;
+  for (i = 0; i < count; i++)
+  {
+    arenaAdopt(&symtabArena, &workers[i].arena);
+    free(workers[i].insertText);
+    free(workers[i].checkText);
+    free(workers[i].listingText);
+    free(workers[i].scopes);
+    free(workers[i].uses);
+    free(workers[i].deps);
+  }
+  free(workers);
+  free(declarations);
+}
+
+/* closeWorkers closes the streams of count workers */
+static void closeWorkers(int count)
+{
+  int i;
+  for (i = 0; i < count; i++)
+  {
+    fclose(workers[i].insertOut);
+    fclose(workers[i].checkOut);
+    fclose(workers[i].listingOut);
+    if (workers[i].error)
+      Error = TRUE;
+  }
+}
+
+void analyzeParallel(TreeNode *syntaxTree, int threads)
+{
+  Worker *mainWorker;
+  TreeNode *t;
+  Batch batch;
+  int i, functions = 0;
+
+  for (t = syntaxTree; t != NULL; t = t->sibling)
+    functions += t->nodekind == FunDeclK;
+  if (threads > functions)
+    threads = functions;
+  /* the shadow stacks are shared, and the global
+   * scope changes under a redefinition
+   */
+  if (threads < 2 || shadowStacks || !distinctGlobals(syntaxTree))
+  {
+    analyze(syntaxTree);
+    return;
+  }
+  startDeclarations(syntaxTree, threads + 1);
+  mainWorker = &workers[threads];
+  enterGlobals(threads);
+
+  /* then the bodies, with the global scope frozen */
+  batch.declarations = declarations;
+  batch.declarationCount = declarationCount;
+  batch.workers = workers;
+  batch.globalScope = globalScope;
+  batch.xrefIndex = xrefIndex;
+  atomic_init(&batch.nextDeclaration, 0);
+  for (i = 0; i < threads; i++)
+  {
+    workers[i].batch = &batch;
+    if (pthread_create(&workers[i].thread, NULL, analysisThread, &workers[i]) != 0)
+    {
+      fprintf(stderr, "Cannot start an analysis thread\n");
+      exit(1);
+    }
+  }
+  for (i = 0; i < threads; i++)
+    pthread_join(workers[i].thread, NULL);
+  closeWorkers(threads + 1);
+
+  /* everything in source order */
+  for (i = 0; i < declarationCount; i++)
+  {
+    Declaration *d = &declarations[i];
+    Worker *w = &workers[d->worker];
+    int j;
+    fwrite(mainWorker->insertText + d->parseStart, 1, d->parseEnd - d->parseStart, listing);
+    fwrite(w->insertText + d->insertStart, 1, d->insertEnd - d->insertStart, listing);
+    if (d->t->nodekind != FunDeclK)
+      continue;
+    append_scopes(w->scopes + d->firstScope, d->scopeCount);
+    for (j = d->firstUse; j < d->firstUse + d->useCount; j++)
+      st_add_use(w->uses[j].entry, w->uses[j].lineno, w->uses[j].column);
+  }
+  pop_scope();
+
+  if (TraceAnalyze)
+  {
+    printSymTab(listing);
+    fprintf(listing, "\nChecking Types...\n");
+  }
+  for (i = 0; i < declarationCount; i++)
+  {
+    Declaration *d = &declarations[i];
+    Worker *w = &workers[d->worker];
+    fwrite(w->checkText + d->checkStart, 1, d->checkEnd - d->checkStart, listing);
+  }
+  endDeclarations(threads + 1);
+}
+
+/* the hash being computed by hashTree, and the
+ * line its positions are relative to
+ */
+static _Thread_local unsigned long long treeHash;
+static _Thread_local int treeLineno;
+
+/* mixNode mixes into treeHash what the analysis
+ * reads from t and the shape of the tree below it.
+ * Lines count from the function's, so a function
+ * that only moved keeps its hash
+ */
+static void mixNode(TreeNode *t, int hasSibling)
+{
+  unsigned long long v[9];
+  int i, shape = hasSibling;
+  for (i = 0; i < MAXCHILDREN; i++)
+    shape = shape << 1 | (t->child[i] != NULL);
+  v[0] = t->nodekind;
+  v[1] = t->type;
+  v[2] = t->op;
+  v[3] = t->val;
+  v[4] = t->name != NULL ? atomOf(t->name)->id + 1 : 0;
+  v[5] = t->lineno - treeLineno;
+  v[6] = t->column;
+  v[7] = t->flag;
+  v[8] = shape;
+  for (i = 0; i < 9; i++)
+    treeHash = (treeHash ^ v[i]) * 1099511628211ull;
+}
+
+static void hashTreeNode(TreeNode *t)
+{
+  mixNode(t, t->sibling != NULL);
+}
+
+/* hashTree returns a 64-bit hash of the declaration
+ * t and its subtree, without its siblings
+ */
+static unsigned long long hashTree(TreeNode *t)
+{
+  int i;
+  treeHash = 14695981039346656037ull;
+  treeLineno = t->lineno;
+  mixNode(t, FALSE);
+  for (i = 0; i < MAXCHILDREN; i++)
+    traverse(t->child[i], hashTreeNode, NULL);
+  return treeHash;
+}
+
+/* cachedBody returns the cached analysis of the
+ * function of d if it still holds, or NULL
+ */
+static CachedFunction *cachedBody(Declaration *d)
+{
+  int id = atomOf(d->t->name)->id;
+  CachedFunction *c = id < cacheSize ? cache[id] : NULL;
+  int i, holds;
+  if (c == NULL || c->hash != d->hash)
+    return NULL;
+  limit_scope(globalScope, d->limit);
+  push_scope(globalScope);
+  for (i = 0, holds = TRUE; i < c->depCount && holds; i++)
+    holds = signature(st_lookup_return_bucket(c->deps[i].name)) == c->deps[i].signature;
+  pop_scope();
+  return holds ? c : NULL;
+}
+
+static char *copyText(const char *text, size_t size)
+{
+  char *copy = (char *)malloc(size + 1);
+  if (copy == NULL)
+  {
+    fprintf(stderr, "Out of memory in analyzer\n");
+    exit(1);
+  }
+  memcpy(copy, text, size);
+  return copy;
+}
+
+/* The texts of a cached function hold line numbers
+ * of the function's own nodes and entries, which a
+ * moved function shifts by the same amount. In the
+ * diagnostics they are the numbers outside quoted
+ * names; in a listing row they follow the location
+ */
+
+/* appendText appends n bytes to the buffer *out of
+ * *size bytes, which has room for them
+ */
+static void appendText(char *out, size_t *size, const char *text, size_t n)
+{
+  memcpy(out + *size, text, n);
+  *size += n;
+}
+
+static int isListingType(const char *word, size_t n)
+{
+  return (n == 3 && memcmp(word, "int", 3) == 0) ||
+         (n == 4 && memcmp(word, "void", 4) == 0) ||
+         (n == 5 && memcmp(word, "int[]", 5) == 0);
+}
+
+/* rebaseLines returns a malloc'ed copy of text with
+ * its line numbers moved by delta, and stores its
+ * size in *newSize. A listing row is name, kind,
+ * type (if known), scope and location, then the
+ * lines as printScopes prints them
+ */
+static char *rebaseLines(const char *text, size_t size, int delta, int listingRows,
+                         size_t *newSize)
+{
+  /* a digit may become at most 12 characters */
+  size_t capacity = 2 * size + 16, n = 0, i = 0;
+  char *out = (char *)malloc(capacity + 1);
+  if (out == NULL)
+  {
+    fprintf(stderr, "Out of memory in analyzer\n");
+    exit(1);
+  }
+  while (i < size)
+  {
+    size_t end = i;
+    while (end < size && text[end] != '\n')
+      end++;
+    if (end < size)
+      end++;
+    if (capacity - n < 12 * (end - i) + 16)
+    {
+      capacity = 2 * capacity + 12 * (end - i) + 16;
+      out = (char *)realloc(out, capacity + 1);
+      if (out == NULL)
+      {
+        fprintf(stderr, "Out of memory in analyzer\n");
+        exit(1);
+      }
+    }
+    if (listingRows)
+    {
+      /* find the location, the fourth or fifth word */
+      size_t word[6], length[6];
+      int words = 0;
+      size_t j = i, lines;
+      while (words < 6)
+      {
+        while (j < end && text[j] == ' ')
+          j++;
+        if (j == end || text[j] == '\n')
+          break;
+        word[words] = j;
+        while (j < end && text[j] != ' ' && text[j] != '\n')
+          j++;
+        length[words] = j - word[words];
+        words++;
+      }
+      if (words >= 4)
+      {
+        int location = words >= 5 && isListingType(text + word[2], length[2]) ? 4 : 3;
+        char number[16];
+        lines = word[location] + (length[location] > 8 ? length[location] : 8) + 2;
+        if (lines > end)
+          lines = end;
+        appendText(out, &n, text + i, lines - i);
+        for (j = lines; j < end;)
+        {
+          while (j < end && (text[j] == ' ' || text[j] == '\n'))
+            j++;
+          if (j == end)
+            break;
+          appendText(out, &n, number,
+                     snprintf(number, sizeof(number), "%3d ", atoi(text + j) + delta));
+          while (j < end && text[j] != ' ')
+            j++;
+        }
+        if (end > i && text[end - 1] == '\n')
+          out[n++] = '\n';
+      }
+      else
+        appendText(out, &n, text + i, end - i);
+    }
+    else
+    {
+      int quoted = FALSE;
+      size_t j = i;
+      while (j < end)
+      {
+        if (text[j] == '"')
+          quoted = !quoted;
+        if (!quoted && text[j] >= '0' && text[j] <= '9')
+        {
+          char number[16];
+          appendText(out, &n, number, snprintf(number, sizeof(number), "%d", atoi(text + j) + delta));
+          while (j < end && text[j] >= '0' && text[j] <= '9')
+            j++;
+        }
+        else
+          out[n++] = text[j++];
+      }
+    }
+    i = end;
+  }
+  out[n] = '\0';
+  *newSize = n;
+  return out;
+}
+
+/* rebaseCached moves the line numbers in the texts
+ * of c to a function now at line lineno
+ */
+static void rebaseCached(CachedFunction *c, int lineno)
+{
+  int delta = lineno - c->lineno;
+  char *text;
+  size_t size;
+  if (delta == 0)
+    return;
+  text = rebaseLines(c->insertText, c->insertSize, delta, FALSE, &size);
+  free(c->insertText);
+  c->insertText = text;
+  c->insertSize = size;
+  text = rebaseLines(c->checkText, c->checkSize, delta, FALSE, &size);
+  free(c->checkText);
+  c->checkText = text;
+  c->checkSize = size;
+  text = rebaseLines(c->listingText, c->listingSize, delta, TRUE, &size);
+  free(c->listingText);
+  c->listingText = text;
+  c->listingSize = size;
+  c->lineno = lineno;
+}
+
+static void freeCached(CachedFunction *c)
+{
+  free(c->deps);
+  free(c->insertText);
+  free(c->checkText);
+  free(c->listingText);
+  free(c);
+}
+
+/* cacheBody keeps the analysis of the function of
+ * d, done by w, for the next build
+ */
+static void cacheBody(Declaration *d, Worker *w)
+{
+  int id = atomOf(d->t->name)->id;
+  CachedFunction *c = (CachedFunction *)calloc(1, sizeof(CachedFunction));
+  if (c == NULL)
+  {
+    fprintf(stderr, "Out of memory in analyzer\n");
+    exit(1);
+  }
+  if (id >= cacheSize)
+  {
+    int size = cacheSize ? cacheSize : 256;
+    while (size <= id)
+      size *= 2;
+    cache = (CachedFunction **)realloc(cache, size * sizeof(CachedFunction *));
+    if (cache == NULL)
+    {
+      fprintf(stderr, "Out of memory in analyzer\n");
+      exit(1);
+    }
+    memset(cache + cacheSize, 0, (size - cacheSize) * sizeof(CachedFunction *));
+    cacheSize = size;
+  }
+  if (cache[id] != NULL)
+    freeCached(cache[id]);
+  c->hash = d->hash;
+  c->depCount = d->depCount;
+  c->deps = (Dependency *)copyText((char *)(w->deps + d->firstDep), d->depCount * sizeof(Dependency));
+  c->insertSize = d->insertEnd - d->insertStart;
+  c->insertText = copyText(w->insertText + d->insertStart, c->insertSize);
+  c->checkSize = d->checkEnd - d->checkStart;
+  c->checkText = copyText(w->checkText + d->checkStart, c->checkSize);
+  c->listingSize = d->listingEnd - d->listingStart;
+  c->listingText = copyText(w->listingText + d->listingStart, c->listingSize);
+  c->lineno = d->t->lineno;
+  c->error = d->error;
+  c->generation = cacheGeneration;
+  cache[id] = c;
+}
+
+void analyzeIncremental(TreeNode *syntaxTree)
+{
+  Worker *w, *mainWorker;
+  int i;
+
+  /* the cross-reference index wants every entry */
+  if (shadowStacks || xrefIndex || !distinctGlobals(syntaxTree))
+  {
+    analyze(syntaxTree);
+    return;
+  }
+  startDeclarations(syntaxTree, 2);
+  w = &workers[0];
+  mainWorker = &workers[1];
+  enterGlobals(1);
+  pop_scope();
+  if (markSize < atomCount())
+  {
+    markSize = atomCount();
+    dependencyMark = (int *)realloc(dependencyMark, markSize * sizeof(int));
+    if (dependencyMark == NULL)
+    {
+      fprintf(stderr, "Out of memory in analyzer\n");
+      exit(1);
+    }
+    memset(dependencyMark, 0, markSize * sizeof(int));
+    markEpoch = 0;
+  }
+
+  /* the bodies that changed, or whose globals did;
+   * their scopes leave the list for their listing
+   */
+  cacheGeneration++;
+  w->recording = TRUE;
+  for (i = 0; i < declarationCount; i++)
+  {
+    Declaration *d = &declarations[i];
+    if (d->t->nodekind != FunDeclK)
+      continue;
+    d->hash = hashTree(d->t);
+    d->cached = cachedBody(d);
+    if (d->cached != NULL)
+    {
+      rebaseCached(d->cached, d->t->lineno);
+      d->cached->generation = cacheGeneration;
+      if (d->cached->error)
+        Error = TRUE;
+      continue;
+    }
+    worker = w;
+    diagnostics = w->insertOut;
+    checkListing = w->checkOut;
+    markEpoch++;
+    d->worker = 0;
+    d->insertStart = ftell(w->insertOut);
+    d->checkStart = ftell(w->checkOut);
+    d->listingStart = ftell(w->listingOut);
+    d->firstScope = scope_count();
+    d->firstDep = w->depCount;
+    w->error = FALSE;
+    analyzeBody(d);
+    worker = NULL;
+    d->error = w->error;
+    if (d->error)
+      Error = TRUE;
+    printScopes(w->listingOut, d->firstScope, scope_count() - d->firstScope);
+    release_scopes(d->firstScope);
+    d->insertEnd = ftell(w->insertOut);
+    d->checkEnd = ftell(w->checkOut);
+    d->listingEnd = ftell(w->listingOut);
+    d->depCount = w->depCount - d->firstDep;
+  }
+  limit_scope(NULL, 0);
+  w->error = FALSE;
+  closeWorkers(2);
+
+  for (i = 0; i < declarationCount; i++)
+  {
+    Declaration *d = &declarations[i];
+    CachedFunction *c = d->cached;
+    fwrite(mainWorker->insertText + d->parseStart, 1, d->parseEnd - d->parseStart, listing);
+    if (c != NULL)
+      fwrite(c->insertText, 1, c->insertSize, listing);
+    else
+      fwrite(workers[d->worker].insertText + d->insertStart, 1, d->insertEnd - d->insertStart, listing);
+  }
+  if (TraceAnalyze)
+  {
+    printSymTab(listing);
+    for (i = 0; i < declarationCount; i++)
+    {
+      Declaration *d = &declarations[i];
+      if (d->cached != NULL)
+        fwrite(d->cached->listingText, 1, d->cached->listingSize, listing);
+      else
+        fwrite(w->listingText + d->listingStart, 1, d->listingEnd - d->listingStart, listing);
+    }
+    fprintf(listing, "\nChecking Types...\n");
+  }
+  for (i = 0; i < declarationCount; i++)
+  {
+    Declaration *d = &declarations[i];
+    CachedFunction *c = d->cached;
+    if (c != NULL)
+      fwrite(c->checkText, 1, c->checkSize, listing);
+    else
+      fwrite(workers[d->worker].checkText + d->checkStart, 1, d->checkEnd - d->checkStart, listing);
+  }
+
+  /* the cache keeps the functions of this build */
+  for (i = 0; i < declarationCount; i++)
+    if (declarations[i].t->nodekind == FunDeclK && declarations[i].cached == NULL)
+      cacheBody(&declarations[i], w);
+  for (i = 0; i < cacheSize; i++)
+    if (cache[i] != NULL && cache[i]->generation != cacheGeneration)
+    {
+      freeCached(cache[i]);
+      cache[i] = NULL;
+    }
+  endDeclarations(2);
+}
+
+/* number of scopes that outlive a declaration in
+ * streaming analysis (global and built-in ones)
+ */
+static _Thread_local int keptScopes = 0;
+
+/* TRUE once a lazily parsed body had a syntax error */
+static _Thread_local int bodyError = FALSE;
+
+void beginAnalysis(void)
+{
+  globalScope = create_scope("global");
+  push_scope(globalScope);
+  push_built_in_functions();
+  keptScopes = scope_count();
+  scopeArena = &localArena;
+  bodyError = FALSE;
+}
+
+/* keepNode copies a declaration node out of the
+ * syntax tree and points its global entry, if it
+ * has one, at the copy
+ */
+static TreeNode *keepNode(TreeNode *t)
+{
+  TreeNode *copy = allocTreeNode(&symtabArena, t->nodekind);
+  *copy = *t;
+  copy->sibling = copy->child[0] = copy->child[1] = NULL;
+  if (t->name != NULL)
+  {
+    BucketList l = st_lookup_return_bucket(t->name);
+    if (l != NULL && l->treeNode == t)
+      l->treeNode = copy;
+  }
+  return copy;
+}
+
+/* keepDeclaration keeps the part of a top-level
+ * declaration that later declarations can see: the
+ * node itself and a function's parameters (which
+ * are global entries if the function is redefined)
+ */
+static void keepDeclaration(TreeNode *t)
+{
+  TreeNode *copy = keepNode(t);
+  TreeNode *param, **link = &copy->child[0];
+  if (t->nodekind != FunDeclK)
+    return;
+  for (param = t->child[0]; param != NULL; param = param->sibling)
+  {
+    *link = keepNode(param);
+    link = &(*link)->sibling;
+  }
+}
+
+void analyzeDeclaration(TreeNode *t)
+{
+  char *checkText;
+  size_t checkSize;
+  /* a syntax error in a skipped body ends the
+   * declarations, as it ends an eager parse
+   */
+  if (t == NULL || bodyError)
+    return;
+  if (t->nodekind == FunDeclK && t->body != 0 && parseBody(t) == NULL)
+  {
+    bodyError = TRUE;
+    return;
+  }
+  diagnostics = listing;
+  fusedTraverse(t, &checkText, &checkSize);
+  fwrite(checkText, 1, checkSize, listing);
+  free(checkText);
+  keepDeclaration(t);
+  release_scopes(keptScopes);
+  arenaFree(&localArena);
+}
+
+void endAnalysis(void)
+{
+  pop_scope();
+  scopeArena = &symtabArena;
+  if (TraceAnalyze)
+    printSymTab(listing);
+}
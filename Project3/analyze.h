@@ -18,4 +18,40 @@ void buildSymtab(TreeNode *);
  */
 void typeCheck(TreeNode *);
 
+/* Procedure analyze does the work of buildSymtab
+ * and typeCheck in a single traversal, with the
+ * same diagnostics and listing
+ */
+void analyze(TreeNode *);
+
+/* Procedure analyzeParallel does the work of analyze
+ * with the function bodies analyzed on up to threads
+ * threads, after the global declarations; the
+ * diagnostics and listing are the same. It falls
+ * back to analyze under shadowStacks or when a
+ * global name is declared twice
+ */
+void analyzeParallel(TreeNode *, int threads);
+
+/* Procedure analyzeIncremental does the work of
+ * analyze, reusing from the last call the analysis
+ * of each function whose syntax tree is the same
+ * and whose names find the same global entries: its
+ * diagnostics and its part of the listing. Only the
+ * global scopes remain listed in the symbol table.
+ * It falls back to analyze as analyzeParallel does,
+ * and with xrefIndex
+ */
+void analyzeIncremental(TreeNode *);
+
+/* Streaming analysis: beginAnalysis opens the
+ * global scope, analyzeDeclaration builds and checks
+ * one top-level declaration and then releases its
+ * local scopes, endAnalysis closes the global scope.
+ * Only global and built-in scopes remain listed
+ */
+void beginAnalysis(void);
+void analyzeDeclaration(TreeNode *);
+void endAnalysis(void);
+
 #endif
@@ -0,0 +1,164 @@
+/****************************************************/
+/* File: arena.c                                    */
+/* Region (arena) allocator for the C-MINUS         */
+/* compiler: bump-pointer allocation in large       */
+/* chunks, released a whole phase at a time         */
+/****************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+_Thread_local Arena astArena = ARENA_INIT("syntax tree");
+_Thread_local Arena symtabArena = ARENA_INIT("symbol table");
+_Thread_local Arena atomArena = ARENA_INIT("atoms");
+_Thread_local Arena localArena = ARENA_INIT("local scopes");
+
+/* newChunk puts a chunk of at least size bytes in
+ * front of the arena's chunk list
+ */
+static ArenaChunk newChunk(Arena *arena, size_t size)
+{
+  ArenaChunk chunk;
+  if (size < ARENA_CHUNK_SIZE)
+    size = ARENA_CHUNK_SIZE;
+  if (size == ARENA_CHUNK_SIZE && arena->spare != NULL)
+  {
+    chunk = arena->spare;
+    arena->spare = chunk->next;
+  }
+  else
+  {
+    /* size is a multiple of ARENA_ALIGN, and so is
+     * the offset of data
+     */
+    chunk = (ArenaChunk)aligned_alloc(ARENA_ALIGN, offsetof(struct ArenaChunkRec, data) + size);
+    if (chunk == NULL)
+    {
+      fprintf(stderr, "Out of memory in arena \"%s\"\n", arena->name);
+      exit(1);
+    }
+    chunk->size = size;
+    arena->chunkCount++;
+  }
+  chunk->used = 0;
+  chunk->next = arena->chunks;
+  arena->chunks = chunk;
+  arena->reserved += size;
+  if (arena->reserved > arena->peakBytes)
+    arena->peakBytes = arena->reserved;
+  return chunk;
+}
+
+void *arenaAlloc(Arena *arena, size_t size)
+{
+  ArenaChunk chunk = arena->chunks;
+  void *p;
+
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  if (chunk == NULL || chunk->size - chunk->used < size)
+  {
+    /* a large object gets a chunk of its own behind
+     * the current one, so the current one stays open
+     */
+    if (chunk != NULL && size > ARENA_CHUNK_SIZE / 4)
+    {
+      ArenaChunk big = newChunk(arena, size);
+      arena->chunks = big->next;
+      big->next = chunk->next;
+      chunk->next = big;
+      chunk = big;
+    }
+    else
+      chunk = newChunk(arena, size);
+  }
+  p = chunk->data + chunk->used;
+  chunk->used += size;
+  memset(p, 0, size);
+  arena->allocations++;
+  arena->bytes += size;
+  return p;
+}
+
+char *arenaCopyString(Arena *arena, const char *s)
+{
+  size_t n;
+  char *t;
+  if (s == NULL)
+    return NULL;
+  n = strlen(s) + 1;
+  t = (char *)arenaAlloc(arena, n);
+  memcpy(t, s, n);
+  return t;
+}
+
+/* freeChunks frees a list of chunks */
+static void freeChunks(ArenaChunk chunk)
+{
+  while (chunk != NULL)
+  {
+    ArenaChunk next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+}
+
+void arenaFree(Arena *arena)
+{
+  freeChunks(arena->chunks);
+  freeChunks(arena->spare);
+  arena->chunks = NULL;
+  arena->spare = NULL;
+  arena->reserved = 0;
+}
+
+void arenaReset(Arena *arena)
+{
+  ArenaChunk chunk = arena->chunks;
+  while (chunk != NULL)
+  {
+    ArenaChunk next = chunk->next;
+    if (chunk->size == ARENA_CHUNK_SIZE)
+    {
+      chunk->next = arena->spare;
+      arena->spare = chunk;
+    }
+    else
+      free(chunk);
+    chunk = next;
+  }
+  arena->chunks = NULL;
+  arena->reserved = 0;
+}
+
+void arenaAdopt(Arena *arena, Arena *from)
+{
+  ArenaChunk last = from->chunks;
+  if (last == NULL)
+    return;
+  /* behind the current chunk, which stays open */
+  while (last->next != NULL)
+    last = last->next;
+  if (arena->chunks == NULL)
+    arena->chunks = from->chunks;
+  else
+  {
+    last->next = arena->chunks->next;
+    arena->chunks->next = from->chunks;
+  }
+  arena->allocations += from->allocations;
+  arena->chunkCount += from->chunkCount;
+  arena->bytes += from->bytes;
+  arena->reserved += from->reserved;
+  if (arena->reserved > arena->peakBytes)
+    arena->peakBytes = arena->reserved;
+  from->chunks = NULL;
+  from->reserved = 0;
+}
+
+void printArenaStats(FILE *out, Arena *arena)
+{
+  fprintf(out, "%-13s  %10ld allocations  %10lu bytes  %6ld chunks  %10lu peak bytes\n",
+          arena->name, arena->allocations, (unsigned long)arena->bytes,
+          arena->chunkCount, (unsigned long)arena->peakBytes);
+}
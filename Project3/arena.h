@@ -0,0 +1,84 @@
+/****************************************************/
+/* File: arena.h                                    */
+/* Region (arena) allocator interface for the       */
+/* C-MINUS compiler                                 */
+/****************************************************/
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* default size of an arena chunk */
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+/* every allocation is aligned to ARENA_ALIGN bytes */
+#define ARENA_ALIGN 16
+
+typedef struct ArenaChunkRec
+{
+  struct ArenaChunkRec *next;
+  size_t size; /* usable bytes in data */
+  size_t used;
+  _Alignas(ARENA_ALIGN) char data[1]; /* so data + used stays aligned */
+} *ArenaChunk;
+
+/* An Arena hands out memory by bumping a pointer
+ * through large chunks. Objects are never freed one
+ * by one; arenaFree releases a whole arena at once
+ */
+typedef struct
+{
+  const char *name; /* for the statistics listing */
+  ArenaChunk chunks; /* current chunk first */
+  ArenaChunk spare;  /* emptied by arenaReset, used before new ones */
+  long allocations;  /* number of arenaAlloc calls */
+  long chunkCount;   /* number of chunks (mallocs) */
+  size_t bytes;      /* bytes handed out */
+  size_t reserved;   /* bytes held in chunks */
+  size_t peakBytes;  /* largest reserved over the arena's life */
+} Arena;
+
+#define ARENA_INIT(name) {name, NULL, NULL, 0, 0, 0, 0, 0}
+
+/* the arenas of the compilation phases, one set
+ * per thread
+ */
+extern _Thread_local Arena astArena;    /* syntax tree nodes and strings (parser) */
+extern _Thread_local Arena symtabArena; /* scopes, buckets, line lists and placeholder nodes (analyzer) */
+extern _Thread_local Arena atomArena;   /* interned identifiers */
+extern _Thread_local Arena localArena;  /* local scopes of one declaration (streaming analysis) */
+
+/* Function arenaAlloc returns size bytes of zeroed,
+ * suitably aligned memory from the arena
+ */
+void *arenaAlloc(Arena *arena, size_t size);
+
+/* Function arenaCopyString copies s into the arena */
+char *arenaCopyString(Arena *arena, const char *s);
+
+/* Procedure arenaFree releases all the memory of
+ * the arena in a single call
+ */
+void arenaFree(Arena *arena);
+
+/* Procedure arenaReset releases all the memory of
+ * the arena as arenaFree does, but keeps its chunks
+ * of the default size for the next allocations, so
+ * a compilation that follows another one on the
+ * same thread finds its memory already mapped
+ */
+void arenaReset(Arena *arena);
+
+/* Procedure arenaAdopt moves the memory of from into
+ * arena, to be released with it; from is left empty
+ */
+void arenaAdopt(Arena *arena, Arena *from);
+
+/* Procedure printArenaStats prints allocation count,
+ * bytes and peak usage of the arena
+ */
+void printArenaStats(FILE *out, Arena *arena);
+
+#endif
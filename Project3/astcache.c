@@ -0,0 +1,254 @@
+/****************************************************/
+/* File: astcache.c                                 */
+/* On-disk syntax tree cache for the C-MINUS        */
+/* compiler. A cache file holds the compact tree    */
+/* and the names it uses; it is found by a hash of  */
+/* the source and checked against a version stamp   */
+/****************************************************/
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include "globals.h"
+#include "util.h"
+#include "atom.h"
+#include "compact.h"
+#include "tokenize.h"
+#include "astcache.h"
+
+/* AST_CACHE_STAMP changes with every build of the
+ * compiler, so a cache never outlives the node
+ * layout it was written with
+ */
+#define AST_CACHE_STAMP "C-MINUS AST 3 " __DATE__ " " __TIME__
+
+/* A cache file is a header, the compact nodes
+ * (including the unused node 0) and nameCount
+ * NUL-terminated names, the ones the tree uses;
+ * name word i in the nodes stands for the i-th name
+ */
+typedef struct
+{
+  char stamp[48];
+  unsigned long long sourceHash;
+  unsigned int sourceLength;
+  unsigned int nodeSize; /* sizeof(CompactNode) */
+  unsigned int nodeCount;
+  unsigned int root;
+  unsigned int nameCount;
+  unsigned int nameBytes;
+  unsigned long long payloadHash; /* of the nodes and names */
+} AstCacheHeader;
+
+_Thread_local char *astCacheDir = NULL;
+
+/* key of the source last seen by loadCachedTree */
+static _Thread_local int haveKey = FALSE;
+static _Thread_local unsigned long long sourceHash;
+static _Thread_local unsigned int sourceLength;
+
+/* 64-bit FNV-1a, continuing from h */
+#define FNV_OFFSET 14695981039346656037ull
+
+static unsigned long long hashBytes(unsigned long long h, const void *bytes, size_t length)
+{
+  const unsigned char *p = (const unsigned char *)bytes;
+  size_t i;
+  for (i = 0; i < length; i++)
+    h = (h ^ p[i]) * 1099511628211ull;
+  return h;
+}
+
+static unsigned long long hashText(const char *text, int length)
+{
+  return hashBytes(FNV_OFFSET, text, length);
+}
+
+static void cachePath(char *path, size_t size)
+{
+  snprintf(path, size, "%s/%016llx.ast", astCacheDir, sourceHash);
+}
+
+TreeNode *loadCachedTree(FILE *source)
+{
+  char path[1024];
+  AstCacheHeader *header;
+  CompactTree ct;
+  TreeNode *tree;
+  char **names;
+  char *buf, *p, *end;
+  char *text;
+  int length;
+  long size;
+  FILE *f;
+  unsigned int i;
+
+  haveKey = FALSE;
+  if (astCacheDir == NULL)
+    return NULL;
+  rewind(source);
+  text = readSource(source, &length);
+  rewind(source);
+  sourceHash = hashText(text, length);
+  sourceLength = length;
+  haveKey = TRUE;
+  free(text);
+
+  cachePath(path, sizeof(path));
+  f = fopen(path, "rb");
+  if (f == NULL)
+    return NULL;
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  rewind(f);
+  buf = (char *)malloc(size > 0 ? size : 1);
+  if (buf == NULL || size < (long)sizeof(AstCacheHeader) ||
+      fread(buf, 1, size, f) != (size_t)size)
+  {
+    fclose(f);
+    free(buf);
+    return NULL;
+  }
+  fclose(f);
+
+  header = (AstCacheHeader *)buf;
+  if (strncmp(header->stamp, AST_CACHE_STAMP, sizeof(header->stamp)) != 0 ||
+      header->sourceHash != sourceHash || header->sourceLength != sourceLength ||
+      header->nodeSize != sizeof(CompactNode) || header->nodeCount < 1 ||
+      (unsigned long)size != sizeof(AstCacheHeader) +
+                                 header->nodeCount * sizeof(CompactNode) + header->nameBytes)
+  {
+    free(buf);
+    return NULL;
+  }
+  if (hashBytes(FNV_OFFSET, buf + sizeof(AstCacheHeader), size - sizeof(AstCacheHeader)) !=
+      header->payloadHash)
+  {
+    free(buf);
+    return NULL;
+  }
+  ct.nodes = (CompactNode *)(buf + sizeof(AstCacheHeader));
+  ct.size = ct.capacity = header->nodeCount;
+  ct.root = header->root;
+
+  names = (char **)malloc((header->nameCount + 1) * sizeof(char *));
+  p = (char *)(ct.nodes + ct.size);
+  end = p + header->nameBytes;
+  for (i = 0; i < header->nameCount; i++)
+  {
+    char *nul = (char *)memchr(p, '\0', end - p);
+    if (nul == NULL)
+    {
+      free(names);
+      free(buf);
+      return NULL;
+    }
+    names[i] = internAtom(p, nul - p)->name;
+    p = nul + 1;
+  }
+  if (!validCompactTree(&ct, header->nameCount))
+  {
+    free(names);
+    free(buf);
+    return NULL;
+  }
+  tree = expandCompactTreeNames(&ct, names);
+  free(names);
+  free(buf);
+  return tree;
+}
+
+/* numberNames renumbers the name words of ct in
+ * order of first use and returns the atoms they
+ * stand for, so a file holds only the tree's names
+ * and not every atom the thread has interned
+ */
+static Atom *numberNames(CompactTree *ct, int *count)
+{
+  int *number = (int *)malloc((atomCount() + 1) * sizeof(int));
+  Atom *atoms = (Atom *)malloc((atomCount() + 1) * sizeof(Atom));
+  int n, i;
+  if (number == NULL || atoms == NULL)
+  {
+    fprintf(stderr, "Out of memory in syntax tree cache\n");
+    exit(1);
+  }
+  for (i = 0; i < atomCount(); i++)
+    number[i] = -1;
+  *count = 0;
+  for (n = 1; n < ct->size; n++)
+  {
+    CompactNode *c = &ct->nodes[n];
+    if (compactName(ct, n) == NULL)
+      continue;
+    if (number[c->p[0]] < 0)
+    {
+      atoms[*count] = atomById(c->p[0]);
+      number[c->p[0]] = (*count)++;
+    }
+    c->p[0] = number[c->p[0]];
+  }
+  free(number);
+  return atoms;
+}
+
+void saveCachedTree(TreeNode *tree)
+{
+  char path[1024], temp[1100];
+  AstCacheHeader header;
+  CompactTree *ct;
+  Atom *atoms;
+  FILE *f;
+  int i, ok, nameCount, fd;
+
+  if (!haveKey || tree == NULL)
+    return;
+  ct = compactTree(tree);
+  atoms = numberNames(ct, &nameCount);
+  memset(&header, 0, sizeof(header));
+  strncpy(header.stamp, AST_CACHE_STAMP, sizeof(header.stamp));
+  header.sourceHash = sourceHash;
+  header.sourceLength = sourceLength;
+  header.nodeSize = sizeof(CompactNode);
+  header.nodeCount = ct->size;
+  header.root = ct->root;
+  header.nameCount = nameCount;
+  header.payloadHash = hashBytes(FNV_OFFSET, ct->nodes, ct->size * sizeof(CompactNode));
+  for (i = 0; i < nameCount; i++)
+  {
+    header.nameBytes += atoms[i]->length + 1;
+    header.payloadHash = hashBytes(header.payloadHash, atoms[i]->name, atoms[i]->length + 1);
+  }
+
+  /* written under a temporary name and renamed, so a
+   * reader never sees a partial file; the name is
+   * unique, as other threads may write the same file
+   */
+  mkdir(astCacheDir, 0777);
+  cachePath(path, sizeof(path));
+  snprintf(temp, sizeof(temp), "%s.XXXXXX", path);
+  fd = mkstemp(temp);
+  f = NULL;
+  if (fd >= 0)
+  {
+    fchmod(fd, 0644);
+    f = fdopen(fd, "wb");
+    if (f == NULL)
+    {
+      close(fd);
+      remove(temp);
+    }
+  }
+  if (f != NULL)
+  {
+    ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+         fwrite(ct->nodes, sizeof(CompactNode), ct->size, f) == (size_t)ct->size;
+    for (i = 0; ok && i < nameCount; i++)
+      ok = fwrite(atoms[i]->name, atoms[i]->length + 1, 1, f) == 1;
+    if (fclose(f) == 0 && ok)
+      rename(temp, path);
+    else
+      remove(temp);
+  }
+  free(atoms);
+  freeCompactTree(ct);
+}
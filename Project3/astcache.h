@@ -0,0 +1,26 @@
+/****************************************************/
+/* File: astcache.h                                 */
+/* On-disk syntax tree cache for the C-MINUS        */
+/* compiler, keyed by a hash of the source text     */
+/****************************************************/
+
+#ifndef _ASTCACHE_H_
+#define _ASTCACHE_H_
+
+/* astCacheDir is the cache directory; NULL (the
+ * default) disables the cache
+ */
+extern _Thread_local char *astCacheDir;
+
+/* Function loadCachedTree hashes the source file and
+ * returns its cached syntax tree, or NULL if there is
+ * none; the file is rewound for the scanner either way
+ */
+TreeNode *loadCachedTree(FILE *source);
+
+/* Procedure saveCachedTree stores the tree of the
+ * source last passed to loadCachedTree
+ */
+void saveCachedTree(TreeNode *tree);
+
+#endif
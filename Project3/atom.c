@@ -0,0 +1,225 @@
+/****************************************************/
+/* File: atom.c                                     */
+/* Atom table implementation for the C-MINUS        */
+/* compiler. Identifiers are interned once by the   */
+/* scanner; the parser, analyzer and symbol table   */
+/* share the interned copy and compare by identity  */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "atom.h"
+#include "arena.h"
+
+/* SHIFT is the power of two used as multiplier
+   in the symbol table hash function  */
+#define SHIFT 4
+
+/* ATOM_HASH selects the full hash of the atom and
+ * scope tables at build time (the listing's bucket
+ * always uses the shift hash modulo SIZE)
+ */
+#define HASH_FNV1A 1  /* FNV-1a */
+#define HASH_SHIFT 2  /* (h << SHIFT) + c, without the modulo */
+#define HASH_DJB2 3   /* h * 33 + c */
+#define HASH_MURMUR 4 /* FNV-1a with the murmur3 finalizer */
+
+#ifndef ATOM_HASH
+#define ATOM_HASH HASH_FNV1A
+#endif
+
+/* initial number of chains, a power of two */
+#define INITIAL_CHAINS 256
+
+struct AtomTableRec
+{
+  Atom *chains;
+  int numChains;
+  Atom *atoms; /* atoms by id */
+  int numAtoms;
+  int maxAtoms;
+  Arena *arena; /* where the atoms are */
+};
+
+/* the calling thread's own table, and the one it
+ * uses (NULL until the first use: its own)
+ */
+static _Thread_local struct AtomTableRec ownTable;
+static _Thread_local AtomTable current = NULL;
+
+static AtomTable currentTable(void)
+{
+  if (current == NULL)
+  {
+    ownTable.arena = &atomArena;
+    current = &ownTable;
+  }
+  return current;
+}
+
+AtomTable atomTable(void)
+{
+  return currentTable();
+}
+
+void useAtomTable(AtomTable table)
+{
+  current = table;
+}
+
+static void outOfMemory(void)
+{
+  fprintf(stderr, "Out of memory in atom table\n");
+  exit(1);
+}
+
+/* grow doubles the number of chains and
+ * redistributes the atoms
+ */
+static void grow(AtomTable table)
+{
+  int n = table->numChains ? table->numChains * 2 : INITIAL_CHAINS;
+  Atom *t = (Atom *)calloc(n, sizeof(Atom));
+  int i;
+  if (t == NULL)
+    outOfMemory();
+  for (i = 0; i < table->numChains; i++)
+  {
+    Atom a = table->chains[i];
+    while (a != NULL)
+    {
+      Atom next = a->next;
+      a->next = t[a->hash & (n - 1)];
+      t[a->hash & (n - 1)] = a;
+      a = next;
+    }
+  }
+  free(table->chains);
+  table->chains = t;
+  table->numChains = n;
+}
+
+void resetAtoms(void)
+{
+  AtomTable table = &ownTable;
+  if (table->numChains > 0)
+    memset(table->chains, 0, table->numChains * sizeof(Atom));
+  table->numAtoms = 0;
+  arenaReset(&atomArena);
+}
+
+void freeAtoms(void)
+{
+  AtomTable table = &ownTable;
+  free(table->chains);
+  free(table->atoms);
+  memset(table, 0, sizeof(*table));
+  arenaFree(&atomArena);
+  current = NULL;
+}
+
+Atom internAtom(const char *s, int length)
+{
+  AtomTable table = currentTable();
+#if ATOM_HASH == HASH_FNV1A || ATOM_HASH == HASH_MURMUR
+  unsigned int h = 2166136261u;
+#elif ATOM_HASH == HASH_DJB2
+  unsigned int h = 5381;
+#else
+  unsigned int h = 0;
+#endif
+  int bucket = 0;
+  Atom a;
+  int i;
+
+  for (i = 0; i < length; i++)
+  {
+#if ATOM_HASH == HASH_SHIFT
+    h = (h << SHIFT) + (unsigned char)s[i];
+#elif ATOM_HASH == HASH_DJB2
+    h = h * 33 + (unsigned char)s[i];
+#else
+    h = (h ^ (unsigned char)s[i]) * 16777619u;
+#endif
+    bucket = ((bucket << SHIFT) + s[i]) % SIZE;
+  }
+#if ATOM_HASH == HASH_MURMUR
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+#endif
+  if (table->numChains == 0)
+    grow(table);
+  for (a = table->chains[h & (table->numChains - 1)]; a != NULL; a = a->next)
+    if (a->hash == h && a->length == length && memcmp(a->name, s, length) == 0)
+      return a;
+
+  a = (Atom)arenaAlloc(table->arena, offsetof(struct AtomRec, name) + length + 1);
+  a->hash = h;
+  a->bucket = bucket;
+  a->length = length;
+  memcpy(a->name, s, length);
+  a->name[length] = '\0';
+  if (table->numAtoms == table->maxAtoms)
+  {
+    table->maxAtoms = table->maxAtoms ? table->maxAtoms * 2 : INITIAL_CHAINS;
+    table->atoms = (Atom *)realloc(table->atoms, table->maxAtoms * sizeof(Atom));
+    if (table->atoms == NULL)
+      outOfMemory();
+  }
+  a->id = table->numAtoms;
+  table->atoms[table->numAtoms++] = a;
+  if (table->numAtoms > table->numChains)
+    grow(table);
+  a->next = table->chains[h & (table->numChains - 1)];
+  table->chains[h & (table->numChains - 1)] = a;
+  return a;
+}
+
+char *intern(const char *s)
+{
+  return internAtom(s, strlen(s))->name;
+}
+
+Atom atomById(int id)
+{
+  AtomTable table = currentTable();
+  if (id < 0 || id >= table->numAtoms)
+    return NULL;
+  return table->atoms[id];
+}
+
+int atomCount(void)
+{
+  return currentTable()->numAtoms;
+}
+
+const char *atomHashName(void)
+{
+#if ATOM_HASH == HASH_SHIFT
+  return "shift";
+#elif ATOM_HASH == HASH_DJB2
+  return "djb2";
+#elif ATOM_HASH == HASH_MURMUR
+  return "murmur";
+#else
+  return "fnv1a";
+#endif
+}
+
+double atomProbeLength(void)
+{
+  AtomTable table = currentTable();
+  long probes = 0;
+  int i;
+  for (i = 0; i < table->numChains; i++)
+  {
+    Atom a;
+    int position = 0;
+    for (a = table->chains[i]; a != NULL; a = a->next)
+      probes += ++position;
+  }
+  return table->numAtoms > 0 ? (double)probes / table->numAtoms : 0.0;
+}
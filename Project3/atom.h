@@ -0,0 +1,84 @@
+/****************************************************/
+/* File: atom.h                                     */
+/* Atom (interned identifier) table interface       */
+/* for the C-MINUS compiler                         */
+/****************************************************/
+
+#ifndef _ATOM_H_
+#define _ATOM_H_
+
+#include <stddef.h>
+
+/* An atom is the unique copy of an identifier.
+ * Two names are equal iff their atoms are the same,
+ * so the name pointer itself is the identity and the
+ * atom can be recovered from it with atomOf().
+ * Both hashes are computed once, when interning
+ */
+typedef struct AtomRec
+{
+  struct AtomRec *next; /* chain in the atom table */
+  unsigned int hash;    /* full hash of the name */
+  int bucket;           /* symbol table hash, 0 <= bucket < SIZE */
+  int id;               /* 32-bit id, in order of interning */
+  struct BucketListRec *visible; /* innermost declaration, with shadowStacks (symtab.h) */
+  int length;
+  char name[1]; /* NUL-terminated, allocated with the atom */
+} *Atom;
+
+/* atomOf maps an interned name back to its atom */
+#define atomOf(s) ((Atom)((char *)(s) - offsetof(struct AtomRec, name)))
+
+/* Each thread has an atom table of its own, so that
+ * compilations on different threads do not share
+ * atoms (nor their visible declarations). A thread
+ * helping with another thread's compilation uses
+ * that thread's table: useAtomTable with what
+ * atomTable returned there, NULL to go back to its
+ * own
+ */
+typedef struct AtomTableRec *AtomTable;
+AtomTable atomTable(void);
+void useAtomTable(AtomTable table);
+
+/* Procedure resetAtoms empties the calling thread's
+ * table for the next compilation, keeping its chains
+ * and the chunks of its arena. Every name interned
+ * before is gone
+ */
+void resetAtoms(void);
+
+/* Procedure freeAtoms releases the calling thread's
+ * table and all its memory, for a thread that ends
+ */
+void freeAtoms(void);
+
+/* Function internAtom returns the atom of
+ * s[0..length), creating it on first use
+ */
+Atom internAtom(const char *s, int length);
+
+/* Function intern returns the interned copy of
+ * the NUL-terminated string s
+ */
+char *intern(const char *s);
+
+/* Function atomById returns the atom with the
+ * given id, or NULL
+ */
+Atom atomById(int id);
+
+/* Function atomCount returns the number of atoms */
+int atomCount(void);
+
+/* Function atomHashName names the hash function
+ * chosen with ATOM_HASH at build time
+ */
+const char *atomHashName(void);
+
+/* Function atomProbeLength returns the average
+ * number of atoms compared to find an interned name
+ */
+double atomProbeLength(void);
+
+#endif
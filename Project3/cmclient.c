@@ -0,0 +1,78 @@
+/****************************************************/
+/* File: cmclient.c                                 */
+/* Client of the C-MINUS compile server: sends its  */
+/* command line to the server and prints the reply  */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "server.h"
+
+/* readInput reads all of standard input into a
+ * malloc'ed buffer
+ */
+static char *readInput(int *length)
+{
+  size_t size = 0, capacity = 4096;
+  char *text = (char *)malloc(capacity);
+  size_t n;
+  if (text == NULL)
+    return NULL;
+  while ((n = fread(text + size, 1, capacity - size, stdin)) > 0)
+  {
+    size += n;
+    if (size == capacity)
+    {
+      char *bigger = (char *)realloc(text, capacity *= 2);
+      if (bigger == NULL)
+      {
+        free(text);
+        return NULL;
+      }
+      text = bigger;
+    }
+  }
+  *length = (int)size;
+  return text;
+}
+
+int main(int argc, char *argv[])
+{
+  ServerRequest request;
+  const char *path = serverPath();
+  char dir[4096];
+  int i, status;
+
+  if (getcwd(dir, sizeof(dir)) == NULL)
+  {
+    fprintf(stderr, "Cannot get the current directory\n");
+    return 1;
+  }
+  request.dir = dir;
+  request.argc = argc;
+  request.argv = argv;
+  request.text = NULL;
+  request.textLength = 0;
+  /* a "-" source file is this standard input */
+  for (i = 1; i < argc && request.text == NULL; i++)
+    if (strcmp(argv[i], "-") == 0 && (request.text = readInput(&request.textLength)) == NULL)
+    {
+      fprintf(stderr, "Out of memory reading standard input\n");
+      return 1;
+    }
+  if (path == NULL)
+  {
+    fprintf(stderr, "Cannot find a private directory for the compile server's socket\n");
+    return 1;
+  }
+  status = requestCompile(path, &request, stdout, stderr);
+  if (status < 0)
+  {
+    fprintf(stderr, "Cannot reach the compile server at %s\n", path);
+    return 1;
+  }
+  free(request.text);
+  return status;
+}
@@ -0,0 +1,238 @@
+/****************************************************/
+/* File: cmgen.c                                    */
+/* Generator of large C-MINUS programs for the      */
+/* scaling benchmark and the stress tests: writes a */
+/* program of the given shape and size to standard  */
+/* output                                           */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* decls n: n global declarations */
+static void genDecls(int n)
+{
+  int i;
+  for (i = 0; i < n; i++)
+    printf("int g%d;\n", i);
+  printf("void main(void) { g0 = 1; }\n");
+}
+
+/* parameter list of n parameters */
+static void genParamList(int n)
+{
+  int i;
+  printf("int f(");
+  for (i = 0; i < n; i++)
+    printf("%sint p%d", i > 0 ? ", " : "", i);
+  printf(")\n{ return p0; }\n");
+}
+
+/* params n: a function of n parameters */
+static void genParams(int n)
+{
+  genParamList(n);
+  printf("void main(void) { }\n");
+}
+
+/* locals n: a body of n local declarations */
+static void genLocals(int n)
+{
+  int i;
+  printf("void main(void)\n{\n");
+  for (i = 0; i < n; i++)
+    printf("  int v%d;\n", i);
+  printf("  v0 = 1;\n}\n");
+}
+
+/* stmts n: a body of n statements */
+static void genStmts(int n)
+{
+  int i;
+  printf("void main(void)\n{\n  int x;\n  x = 0;\n");
+  for (i = 1; i < n; i++)
+    printf("  x = x + %d;\n", i % 10);
+  printf("}\n");
+}
+
+/* args n: a call with n arguments */
+static void genArgs(int n)
+{
+  int i;
+  genParamList(n);
+  printf("void main(void)\n{\n  int x;\n  x = f(");
+  for (i = 0; i < n; i++)
+    printf("%s%d", i > 0 ? ", " : "", i % 10);
+  printf(");\n}\n");
+}
+
+/* repeat prints text n times */
+static void repeat(const char *text, int n)
+{
+  int i;
+  for (i = 0; i < n; i++)
+    fputs(text, stdout);
+}
+
+/* the nesting shapes put one construct n deep in
+ * the body of main, which declares x and a[10]
+ */
+static void beginMain(void)
+{
+  printf("int f(int p) { return p; }\n");
+  printf("void main(void)\n{\n  int x;\n  int a[10];\n  x = 0;\n");
+}
+
+/* ifs n: n nested if statements */
+static void genIfs(int n)
+{
+  beginMain();
+  repeat("if (x) ", n);
+  printf("x = 1;\n}\n");
+}
+
+/* whiles n: n nested while statements */
+static void genWhiles(int n)
+{
+  beginMain();
+  repeat("while (x) ", n);
+  printf("x = 1;\n}\n");
+}
+
+/* blocks n: n nested compound statements */
+static void genBlocks(int n)
+{
+  beginMain();
+  repeat("{ ", n);
+  printf("x = 1;");
+  repeat(" }", n);
+  printf("\n}\n");
+}
+
+/* parens n: an expression in n parentheses */
+static void genParens(int n)
+{
+  beginMain();
+  printf("x = ");
+  repeat("(", n);
+  printf("1");
+  repeat(")", n);
+  printf(";\n}\n");
+}
+
+/* sums n: n left-nested additions, flat to the
+ * parser but n deep in the syntax tree
+ */
+static void genSums(int n)
+{
+  beginMain();
+  printf("x = 1");
+  repeat(" + 1", n);
+  printf(";\n}\n");
+}
+
+/* assigns n: n right-nested assignments */
+static void genAssigns(int n)
+{
+  beginMain();
+  repeat("x = ", n);
+  printf("1;\n}\n");
+}
+
+/* indexes n: n nested array subscripts */
+static void genIndexes(int n)
+{
+  beginMain();
+  printf("x = ");
+  repeat("a[", n);
+  printf("0");
+  repeat("]", n);
+  printf(";\n}\n");
+}
+
+/* calls n: n nested calls */
+static void genCalls(int n)
+{
+  beginMain();
+  printf("x = ");
+  repeat("f(", n);
+  printf("0");
+  repeat(")", n);
+  printf(";\n}\n");
+}
+
+/* funcs n: n functions with a nested block each;
+ * every 1000th uses the undeclared name u
+ */
+static void genFuncs(int n)
+{
+  int i;
+  for (i = 0; i < n; i++)
+  {
+    printf("int f%d(int p)\n{\n  int a;\n  {\n    int b;\n", i);
+    printf("    b = p;\n    a = b;\n  }\n");
+    if (i % 1000 == 999)
+      printf("  u;\n");
+    printf("  return a;\n}\n");
+  }
+  printf("void main(void) { f0(1); }\n");
+}
+
+/* scopes n: a body and n - 1 blocks nested in it,
+ * declaring one name each; the innermost uses the
+ * outermost and the undeclared name w
+ */
+static void genScopes(int n)
+{
+  int i;
+  printf("void main(void)\n{ int v0;\n");
+  for (i = 1; i < n; i++)
+    printf("{ int v%d;\n", i);
+  printf("v0 = v%d;\nw;\n", n - 1);
+  repeat("}", n);
+  printf("\n");
+}
+
+typedef struct
+{
+  const char *name;
+  void (*generate)(int n);
+} Shape;
+
+static Shape shapes[] = {
+    {"decls", genDecls},
+    {"params", genParams},
+    {"locals", genLocals},
+    {"stmts", genStmts},
+    {"args", genArgs},
+    {"ifs", genIfs},
+    {"whiles", genWhiles},
+    {"blocks", genBlocks},
+    {"parens", genParens},
+    {"sums", genSums},
+    {"assigns", genAssigns},
+    {"indexes", genIndexes},
+    {"calls", genCalls},
+    {"funcs", genFuncs},
+    {"scopes", genScopes},
+};
+
+#define SHAPES ((int)(sizeof(shapes) / sizeof(shapes[0])))
+
+int main(int argc, char *argv[])
+{
+  int i;
+  if (argc == 3 && atoi(argv[2]) > 0)
+    for (i = 0; i < SHAPES; i++)
+      if (strcmp(argv[1], shapes[i].name) == 0)
+      {
+        shapes[i].generate(atoi(argv[2]));
+        return 0;
+      }
+  fprintf(stderr, "usage: %s <shape> <n>\nshapes:", argv[0]);
+  for (i = 0; i < SHAPES; i++)
+    fprintf(stderr, " %s", shapes[i].name);
+  fprintf(stderr, "\n");
+  return 1;
+}
@@ -11,15 +11,40 @@
 #include "util.h"
 #include "scan.h"
 #include "parse.h"
+#include "astcache.h"
 
 #define YYSTYPE TreeNode *
-static char * savedName; /* for use in assignments */
-static int savedLineNo;  /* ditto */
-static TreeNode * savedTree; /* stores syntax tree for later return */
+/* right-recursive rules (nested statements and
+ * expressions) need one stack entry per level
+ */
+#define YYMAXDEPTH 1000000
+static _Thread_local char * savedName; /* for use in assignments */
+static _Thread_local int savedLineNo;  /* ditto */
+static _Thread_local TreeNode * savedTree; /* stores syntax tree for later return */
+/* the lookahead token, for yyerror */
+static _Thread_local int lastToken;
+
+static int yylex(YYSTYPE * lvalp); /* lex와 error를 막기 위해 추가 */
+
+/* List rules prepend each new element and the rule
+ * that uses a finished list reverses it once, so
+ * building a list of N elements takes O(N) time
+ */
+static TreeNode * prependSibling(TreeNode * list, TreeNode * t);
+static TreeNode * reverseSiblings(TreeNode * list);
+static TreeNode * addDeclaration(TreeNode * list, TreeNode * t);
 
-static int yylex(void); /* lex와 error를 막기 위해 추가 */
+_Thread_local void (* declarationProc)(TreeNode *) = NULL;
 %}
 
+/* yyparse() pulls tokens from getToken(); parseTokens()
+ * pushes them one at a time (see pipeline.c). The
+ * parser is pure, keeping its state on the stack,
+ * so threads can parse side by side
+ */
+%define api.push-pull both
+%define api.pure full
+
 %token IF WHILE RETURN INT VOID
 %nonassoc RPAREN
 %nonassoc ELSE 
@@ -30,23 +55,12 @@ static int yylex(void); /* lex와 error를 막기 위해 추가 */
 
 %% /* Grammar for C-MINUS */
 
-program : declaration_list { savedTree = $1; }
+program : declaration_list { savedTree = reverseSiblings($1); }
         ;  
 
 declaration_list : declaration_list declaration 
-                   { 
-                    YYSTYPE t = $1;
-                    if(t != NULL)
-                    {
-                      while(t->sibling != NULL)
-                        t = t->sibling;
-                      t->sibling = $2;
-                      $$ = $1;
-                    }
-                    else
-                      $$ = $2;
-                   }
-                 | declaration { $$ = $1; }
+                   { $$ = addDeclaration($1, $2); }
+                 | declaration { $$ = addDeclaration(NULL, $1); }
                  ;
 
 declaration : var_declaration { $$ = $1; }
@@ -69,7 +83,8 @@ identifier : ID
              {
               $$ = newTreeNode(VarExpK); 
               $$->lineno = lineno;
-              $$->name = copyString(tokenString);
+              $$->name = tokenName;
+              $$->column = tokenColumn;
              }
            ;
 
@@ -87,6 +102,7 @@ var_declaration : type_specifier identifier SEMI
                     $$->type = $1->type;
                     $$->lineno = $2->lineno;                
                     $$->name = $2->name;                 
+                    $$->column = $2->column;
                   }
                  
                  | type_specifier identifier LBRACE number RBRACE SEMI
@@ -100,6 +116,7 @@ var_declaration : type_specifier identifier SEMI
                     
                     $$->lineno = $2->lineno;
                     $$->name = $2->name;
+                    $$->column = $2->column;
                     $$->child[0] = $4;
                    }
                  ;
@@ -110,12 +127,13 @@ fun_declaration : type_specifier identifier LPAREN params RPAREN compound_stmt
                     $$->type = $1->type;
                     $$->lineno = $2->lineno;
                     $$->name = $2->name;
+                    $$->column = $2->column;
                     $$->child[0] = $4;
                     $$->child[1] = $6;
                   } 
                 ;
 
-params : param_list {$$ = $1;}
+params : param_list {$$ = reverseSiblings($1);}
        | VOID
          {
           $$ = newTreeNode(ParamK);
@@ -125,18 +143,7 @@ params : param_list {$$ = $1;}
        ;
 
 param_list : param_list COMMA param
-             {
-              YYSTYPE t = $1;
-              if(t != NULL)
-              {
-                while(t->sibling != NULL)
-                  t = t->sibling;
-                t->sibling = $3;
-                $$ = $1;
-              }
-              else
-                $$ = $3;
-             }
+             { $$ = prependSibling($1, $3); }
             | param
               {$$ = $1;}
             ;
@@ -147,6 +154,7 @@ param : type_specifier identifier
           $$->type = $1->type;
           $$->lineno = $2->lineno;
           $$->name = $2->name;
+          $$->column = $2->column;
         }
       | type_specifier identifier LBRACE RBRACE
         {
@@ -159,6 +167,7 @@ param : type_specifier identifier
           
           $$->lineno = $2->lineno;
           $$->name = $2->name;
+          $$->column = $2->column;
         }                    
       ;
 
@@ -166,40 +175,18 @@ compound_stmt : LCURLY local_declarations statement_list RCURLY
                 {
                   $$ = newTreeNode(CompStmtK);
                   $$->lineno = lineno;
-                  $$->child[0] = $2;
-                  $$->child[1] = $3;
+                  $$->child[0] = reverseSiblings($2);
+                  $$->child[1] = reverseSiblings($3);
                 }
             ;
 
 local_declarations : local_declarations var_declaration
-                     {
-                      YYSTYPE t = $1;
-                      if(t != NULL)
-                      {
-                        while(t->sibling != NULL)
-                          t = t->sibling;
-                        t->sibling = $2;
-                        $$ = $1;
-                      }
-                      else
-                        $$ = $2;
-                     }
+                     { $$ = prependSibling($1, $2); }
                    | empty {$$ = NULL;}
                    ;
 
 statement_list : statement_list statement
-                 {
-                  YYSTYPE t = $1;
-                  if(t != NULL)
-                  {
-                    while(t->sibling != NULL)
-                      t = t->sibling;
-                    t->sibling = $2;
-                    $$ = $1;
-                  }
-                  else
-                    $$ = $2;
-                 } 
+                 { $$ = prependSibling($1, $2); } 
                | empty {$$ = NULL;}
                ;
 
@@ -258,12 +245,14 @@ var : identifier
       {
         $$ = newTreeNode(VarExpK);
         $$->name = $1->name;
+        $$->column = $1->column;
         $$->lineno = $1->lineno;
       }                  
     | identifier LBRACE expression RBRACE
       {
         $$ = newTreeNode(VarExpK);
         $$->name = $1->name;
+        $$->column = $1->column;
         $$->lineno = $1->lineno;
         $$->child[0] = $3;
       }
@@ -387,28 +376,18 @@ call : identifier LPAREN args RPAREN
        {
         $$ = newTreeNode(CallK);
         $$->name = $1->name;
+        $$->column = $1->column;
         $$->lineno = $1->lineno;
         $$->child[0] = $3;
        }
       ;
 
-args : arg_list {$$ = $1;}
+args : arg_list {$$ = reverseSiblings($1);}
      | empty {$$ = NULL;}
      ; 
 
 arg_list : arg_list COMMA expression
-           {
-            YYSTYPE t = $1;
-            if(t != NULL)
-            {
-              while(t->sibling != NULL)
-                t = t->sibling;
-              t->sibling = $3;
-              $$ = $1;
-            }
-            else
-              $$ = $3;
-           }
+           { $$ = prependSibling($1, $3); }
          | expression {$$ = $1;}
          ;
 
@@ -420,19 +399,74 @@ empty : {$$ = NULL;}
 int yyerror(char * message)
 { fprintf(listing,"Syntax error at line %d: %s\n",lineno,message);
   fprintf(listing,"Current token: ");
-  printToken(yychar,tokenString);
+  printToken(lastToken,tokenString);
   Error = TRUE;
   return 0;
 }
 
+/* prependSibling puts t (a single node or NULL)
+ * in front of a list under construction
+ */
+static TreeNode * prependSibling(TreeNode * list, TreeNode * t)
+{ if (t == NULL)
+    return list;
+  t->sibling = list;
+  return t;
+}
+
+/* addDeclaration adds a top-level declaration to
+ * the list, or hands it to declarationProc as soon
+ * as it is reduced when streaming
+ */
+static TreeNode * addDeclaration(TreeNode * list, TreeNode * t)
+{ if (declarationProc != NULL)
+  { declarationProc(t);
+    return NULL;
+  }
+  return prependSibling(list, t);
+}
+
+/* reverseSiblings restores source order of a list
+ * built by prependSibling
+ */
+static TreeNode * reverseSiblings(TreeNode * list)
+{ TreeNode * reversed = NULL;
+  while (list != NULL)
+  { TreeNode * next = list->sibling;
+    list->sibling = reversed;
+    reversed = list;
+    list = next;
+  }
+  return reversed;
+}
+
 /* yylex calls getToken to make Yacc/Bison output
  * compatible with ealier versions of the C-MINUS scanner
  */
-static int yylex(void)
-{ return getToken(); }
+static int yylex(YYSTYPE * lvalp)
+{ (void) lvalp; /* the actions build the values */
+  lastToken = getToken();
+  return lastToken;
+}
 
 TreeNode * parse(void)
-{ yyparse();
+{ TreeNode * t = declarationProc == NULL ? loadCachedTree(source) : NULL;
+  if (t != NULL) return t;
+  /* a thread's last tree went with its arena */
+  savedTree = NULL;
+  yyparse();
+  if (!Error) saveCachedTree(savedTree);
   return savedTree;
 }
 
+TreeNode * parseTokens(TokenType (* nextToken)(void))
+{ yypstate * ps = yypstate_new();
+  int status;
+  savedTree = NULL;
+  do
+  { lastToken = nextToken();
+    status = yypush_parse(ps, lastToken, NULL);
+  } while (status == YYPUSH_MORE);
+  yypstate_delete(ps);
+  return savedTree;
+}
@@ -0,0 +1,138 @@
+/****************************************************/
+/* File: cmquery.c                                  */
+/* Query tool for C-MINUS symbol table files:       */
+/* where a name is defined and used, and its type   */
+/****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "symfile.h"
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+static const char *kindNames[] = {"variable", "function", "parameter"};
+static const char *typeNames[] = {"int", "void", "int[]", "void[]", "undetermined"};
+
+static const char *kindName(unsigned int kind)
+{
+  return kind < sizeof(kindNames) / sizeof(kindNames[0]) ? kindNames[kind] : "?";
+}
+
+static const char *typeName(unsigned int type)
+{
+  return type < sizeof(typeNames) / sizeof(typeNames[0]) ? typeNames[type] : "?";
+}
+
+static void printSymbol(const SymFileHeader *h, const SymFileSymbol *sym)
+{
+  const char *base = (const char *)h;
+  const char *strings = base + h->stringOffset;
+  const SymFileScope *scopes = (const SymFileScope *)(base + h->scopeOffset);
+  const SymFileRef *refs = (const SymFileRef *)(base + h->refOffset);
+  const SymFileScope *scope = &scopes[sym->scope < h->scopeCount ? sym->scope : 0];
+  unsigned int i, end;
+
+  printf("%s: %s %s in %s (depth %u), location %d\n",
+         strings + (sym->name % h->stringSize), kindName(sym->kind), typeName(sym->type),
+         strings + (scope->name % h->stringSize), scope->depth, sym->memloc);
+  printf("  defined at %u:%u\n", sym->line, sym->column);
+  end = sym->firstRef + sym->lineCount + sym->useCount;
+  if (sym->firstRef > h->refCount || end > h->refCount || end < sym->firstRef)
+    return;
+  printf("  listed lines %u", sym->line);
+  for (i = 0; i < sym->lineCount; i++)
+    printf(" %u", refs[sym->firstRef + i].line);
+  printf("\n");
+  if (sym->useCount > 0)
+  {
+    printf("  used at");
+    for (i = sym->lineCount; i < sym->lineCount + sym->useCount; i++)
+      printf(" %u:%u", refs[sym->firstRef + i].line, refs[sym->firstRef + i].column);
+    printf("\n");
+  }
+}
+
+/* query prints every symbol named name; returns the
+ * number found
+ */
+static int query(const SymFileHeader *h, const char *name, int print)
+{
+  const char *base = (const char *)h;
+  const unsigned int *index = (const unsigned int *)(base + h->indexOffset);
+  const SymFileSymbol *symbols = (const SymFileSymbol *)(base + h->symbolOffset);
+  const char *strings = base + h->stringOffset;
+  unsigned int mask = h->indexSize - 1;
+  unsigned int slot = symFileHash(name) & mask;
+  unsigned int probes;
+  int found = 0;
+
+  for (probes = 0; probes < h->indexSize && index[slot] != 0; probes++)
+  {
+    unsigned int s = index[slot] - 1;
+    if (s < h->symbolCount && symbols[s].name < h->stringSize &&
+        strcmp(strings + symbols[s].name, name) == 0)
+    {
+      if (print)
+        printSymbol(h, &symbols[s]);
+      found++;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return found;
+}
+
+static double now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+  const SymFileHeader *h;
+  int timing = FALSE, argi = 1, status = 0;
+
+  if (argi < argc && strcmp(argv[argi], "-t") == 0)
+  {
+    timing = TRUE;
+    argi++;
+  }
+  if (argc - argi < 2)
+  {
+    fprintf(stderr, "usage: %s [-t] <symbol file> <name>...\n", argv[0]);
+    exit(1);
+  }
+  h = mapSymtabFile(argv[argi]);
+  if (h == NULL)
+  {
+    fprintf(stderr, "%s is not a C-MINUS symbol table file\n", argv[argi]);
+    exit(1);
+  }
+  for (argi++; argi < argc; argi++)
+  {
+    if (query(h, argv[argi], TRUE) == 0)
+    {
+      printf("%s: not found\n", argv[argi]);
+      status = 1;
+    }
+    if (timing)
+    {
+      /* the average of many lookups, without printing */
+      int i, n = 100000;
+      double start = now();
+      for (i = 0; i < n; i++)
+        query(h, argv[argi], FALSE);
+      printf("  (%.3f us per lookup)\n", (now() - start) * 1e6 / n);
+    }
+  }
+  return status;
+}
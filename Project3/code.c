@@ -10,12 +10,12 @@
 #include "code.h"
 
 /* TM location number for current instruction emission */
-static int emitLoc = 0 ;
+static _Thread_local int emitLoc = 0 ;
 
 /* Highest TM location emitted so far
    For use in conjunction with emitSkip,
    emitBackup, and emitRestore */
-static int highEmitLoc = 0;
+static _Thread_local int highEmitLoc = 0;
 
 /* Procedure emitComment prints a comment line 
  * with comment c in the code file
@@ -0,0 +1,392 @@
+/****************************************************/
+/* File: compact.c                                  */
+/* Compact index-based syntax tree for the C-MINUS  */
+/* compiler: 24-byte nodes in one array, linked by  */
+/* 32-bit indices, names kept as atom ids           */
+/****************************************************/
+
+#include "globals.h"
+#include "util.h"
+#include "atom.h"
+#include "compact.h"
+
+/* payload slot of child i, or -1 */
+static int childSlot(NodeKind kind, int i)
+{
+  int slot = kind == SelectStmtK ? i : i + 1;
+  return slot < 3 ? slot : -1;
+}
+
+static int isNamed(NodeKind kind)
+{
+  switch (kind)
+  {
+  case VarDeclK:
+  case FunDeclK:
+  case ParamK:
+  case CallK:
+  case VarExpK:
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
+static NodeIndex newCompactNode(CompactTree *ct)
+{
+  if (ct->size == ct->capacity)
+  {
+    ct->capacity *= 2;
+    ct->nodes = (CompactNode *)realloc(ct->nodes, ct->capacity * sizeof(CompactNode));
+    if (ct->nodes == NULL)
+    {
+      fprintf(stderr, "Out of memory in compact tree\n");
+      exit(1);
+    }
+  }
+  memset(&ct->nodes[ct->size], 0, sizeof(CompactNode));
+  return ct->size++;
+}
+
+/* compactList converts the sibling list starting
+ * at t, laying out each node before its children
+ * and its children before its next sibling
+ */
+static NodeIndex compactList(CompactTree *ct, TreeNode *t)
+{
+  NodeIndex first = NO_NODE, prev = NO_NODE;
+  while (t != NULL)
+  {
+    NodeIndex n = newCompactNode(ct);
+    int i;
+    if (prev != NO_NODE)
+      ct->nodes[prev].sibling = n;
+    else
+      first = n;
+    ct->nodes[n].info = (t->nodekind & 0xF) | ((t->type & 0x7) << 4) |
+                        ((t->flag ? 1 : 0) << 7) | ((unsigned int)t->lineno << 8);
+    ct->nodes[n].column = (unsigned int)t->column;
+    if (t->nodekind == OpK)
+      ct->nodes[n].p[0] = t->op;
+    else if (t->nodekind == ConstK)
+      ct->nodes[n].p[0] = (unsigned int)t->val;
+    else if (isNamed(t->nodekind))
+      ct->nodes[n].p[0] = t->name != NULL ? (unsigned int)atomOf(t->name)->id : NO_ATOM;
+    for (i = 0; i < MAXCHILDREN; i++)
+    {
+      int slot = childSlot(t->nodekind, i);
+      if (slot >= 0 && t->child[i] != NULL)
+      {
+        /* the array may move while the child is built */
+        NodeIndex c = compactList(ct, t->child[i]);
+        ct->nodes[n].p[slot] = c;
+      }
+    }
+    prev = n;
+    t = t->sibling;
+  }
+  return first;
+}
+
+CompactTree *compactTree(TreeNode *tree)
+{
+  CompactTree *ct = (CompactTree *)malloc(sizeof(CompactTree));
+  ct->capacity = 1024;
+  ct->nodes = (CompactNode *)malloc(ct->capacity * sizeof(CompactNode));
+  ct->size = 1; /* index 0 is NO_NODE */
+  ct->root = compactList(ct, tree);
+  return ct;
+}
+
+TreeNode *expandCompactTree(const CompactTree *ct)
+{
+  return expandCompactTreeNames(ct, NULL);
+}
+
+TreeNode *expandCompactTreeNames(const CompactTree *ct, char **names)
+{
+  /* node i becomes nodes[i]: every link can be set
+   * without visiting the target first
+   */
+  TreeNode *nodes = (TreeNode *)arenaAlloc(&astArena, ct->size * sizeof(TreeNode));
+  int n, i;
+  for (n = 1; n < ct->size; n++)
+  {
+    const CompactNode *c = &ct->nodes[n];
+    TreeNode *t = &nodes[n];
+    t->nodekind = COMPACT_KIND(c);
+    t->type = COMPACT_TYPE(c);
+    t->flag = COMPACT_FLAG(c);
+    t->lineno = COMPACT_LINENO(c);
+    t->column = (int)c->column;
+    t->sibling = c->sibling != NO_NODE ? &nodes[c->sibling] : NULL;
+    if (t->nodekind == OpK)
+      t->op = c->p[0];
+    else if (t->nodekind == ConstK)
+      t->val = (int)c->p[0];
+    else if (isNamed(t->nodekind) && c->p[0] != NO_ATOM)
+      t->name = names != NULL ? names[c->p[0]] : atomById(c->p[0])->name;
+    for (i = 0; i < MAXCHILDREN; i++)
+    {
+      int slot = childSlot(t->nodekind, i);
+      if (slot >= 0 && c->p[slot] != NO_NODE)
+        t->child[i] = &nodes[c->p[slot]];
+    }
+  }
+  return ct->root != NO_NODE ? &nodes[ct->root] : NULL;
+}
+
+static int isOperator(unsigned int op)
+{
+  switch (op)
+  {
+  case PLUS:
+  case MINUS:
+  case TIMES:
+  case OVER:
+  case LT:
+  case LE:
+  case GT:
+  case GE:
+  case EQ:
+  case NE:
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
+/* the sorts of subtrees the grammar puts in each
+ * child slot; the list sorts may have siblings
+ */
+typedef enum
+{
+  NoSort,
+  DeclSort,
+  LocalSort,
+  ParamSort,
+  BodySort,
+  StmtListSort,
+  StmtSort,
+  ArgSort,
+  ExpSort,
+  VarSort,
+  SizeSort
+} Sort;
+
+#define VIA_SIBLING 0x80
+
+static int isListSort(Sort sort)
+{
+  return sort == DeclSort || sort == LocalSort || sort == ParamSort ||
+         sort == StmtListSort || sort == ArgSort;
+}
+
+static int isExpKind(NodeKind kind)
+{
+  return kind == AssignK || kind == OpK || kind == CallK ||
+         kind == VarExpK || kind == ConstK;
+}
+
+static int fitsSort(NodeKind kind, Sort sort)
+{
+  switch (sort)
+  {
+  case DeclSort:
+    return kind == VarDeclK || kind == FunDeclK;
+  case LocalSort:
+    return kind == VarDeclK;
+  case ParamSort:
+    return kind == ParamK;
+  case BodySort:
+    return kind == CompStmtK;
+  case StmtListSort:
+  case StmtSort:
+    return kind == CompStmtK || kind == SelectStmtK || kind == IterStmtK ||
+           kind == RetStmtK || isExpKind(kind);
+  case ArgSort:
+  case ExpSort:
+    return isExpKind(kind);
+  case VarSort:
+    return kind == VarExpK;
+  case SizeSort:
+    return kind == ConstK;
+  default:
+    return FALSE;
+  }
+}
+
+/* childSort returns the sort of child i of node c,
+ * or NoSort if the grammar leaves that slot empty,
+ * and sets *required if it may not be empty
+ */
+static Sort childSort(const CompactNode *c, int i, int *required)
+{
+  static const Sort sorts[ConstK + 1][MAXCHILDREN] = {
+      [VarDeclK] = {SizeSort},
+      [FunDeclK] = {ParamSort, BodySort},
+      [CompStmtK] = {LocalSort, StmtListSort},
+      [SelectStmtK] = {ExpSort, StmtSort, StmtSort},
+      [IterStmtK] = {ExpSort, StmtSort},
+      [RetStmtK] = {ExpSort},
+      [AssignK] = {VarSort, ExpSort},
+      [OpK] = {ExpSort, ExpSort},
+      [CallK] = {ArgSort},
+      [VarExpK] = {ExpSort},
+  };
+  NodeKind kind = COMPACT_KIND(c);
+  if (kind == VarDeclK)
+    *required = COMPACT_TYPE(c) == IntArray || COMPACT_TYPE(c) == VoidArray;
+  else
+    *required = kind == FunDeclK || kind == AssignK || kind == OpK ||
+                ((kind == SelectStmtK || kind == IterStmtK) && i == 0);
+  if (kind == VarDeclK && !*required)
+    return NoSort;
+  *required = *required && sorts[kind][i] != NoSort;
+  return sorts[kind][i];
+}
+
+/* linkTo checks a link of node n to node c of the
+ * given sort: the preorder layout puts c after n,
+ * and every node but the root is linked to exactly
+ * once
+ */
+static int linkTo(const CompactTree *ct, NodeIndex n, NodeIndex c,
+                  int sort, unsigned char *sorts)
+{
+  if (c == NO_NODE)
+    return TRUE;
+  if (c <= n || c >= (NodeIndex)ct->size || sorts[c] != NoSort)
+    return FALSE;
+  sorts[c] = (unsigned char)sort;
+  return TRUE;
+}
+
+int validCompactTree(const CompactTree *ct, unsigned int nameCount)
+{
+  unsigned char *sorts;
+  int n, i, ok;
+
+  if (ct->size < 1 || ct->root != (ct->size > 1 ? 1u : NO_NODE))
+    return FALSE;
+  sorts = (unsigned char *)calloc(ct->size, 1);
+  if (sorts == NULL)
+    return FALSE;
+  if (ct->size > 1)
+    sorts[1] = DeclSort;
+  ok = TRUE;
+  for (n = 1; ok && n < ct->size; n++)
+  {
+    const CompactNode *c = &ct->nodes[n];
+    NodeKind kind = COMPACT_KIND(c);
+    Sort sort = (Sort)(sorts[n] & ~VIA_SIBLING);
+    ok = kind <= ConstK && COMPACT_TYPE(c) <= Undetermined &&
+         fitsSort(kind, sort) &&
+         (c->sibling == NO_NODE || isListSort(sort)) &&
+         linkTo(ct, n, c->sibling, sort | VIA_SIBLING, sorts);
+    if (kind == OpK)
+      ok = ok && isOperator(c->p[0]);
+    else if (kind == ParamK && c->p[0] == NO_ATOM)
+      /* only the lone parameter of (void) is unnamed */
+      ok = ok && COMPACT_TYPE(c) == Void && c->sibling == NO_NODE &&
+           !(sorts[n] & VIA_SIBLING);
+    else if (isNamed(kind))
+      ok = ok && c->p[0] < nameCount;
+    for (i = 0; ok && i < MAXCHILDREN; i++)
+    {
+      int slot = childSlot(kind, i), required;
+      Sort childsort = childSort(c, i, &required);
+      NodeIndex child = slot >= 0 ? c->p[slot] : NO_NODE;
+      if (child == NO_NODE)
+        ok = !required;
+      else
+        ok = childsort != NoSort && linkTo(ct, n, child, childsort, sorts);
+    }
+  }
+  /* and every node but the root is reached */
+  for (n = 2; ok && n < ct->size; n++)
+    ok = sorts[n] != NoSort;
+  free(sorts);
+  return ok;
+}
+
+void freeCompactTree(CompactTree *ct)
+{
+  if (ct == NULL)
+    return;
+  free(ct->nodes);
+  free(ct);
+}
+
+NodeIndex compactChild(const CompactTree *ct, NodeIndex n, int i)
+{
+  int slot = childSlot(COMPACT_KIND(&ct->nodes[n]), i);
+  return slot >= 0 ? ct->nodes[n].p[slot] : NO_NODE;
+}
+
+NodeIndex compactSibling(const CompactTree *ct, NodeIndex n)
+{
+  return ct->nodes[n].sibling;
+}
+
+char *compactName(const CompactTree *ct, NodeIndex n)
+{
+  const CompactNode *c = &ct->nodes[n];
+  if (!isNamed(COMPACT_KIND(c)) || c->p[0] == NO_ATOM)
+    return NULL;
+  return atomById(c->p[0])->name;
+}
+
+void compactTraverse(const CompactTree *ct, NodeIndex n,
+                     void (*preProc)(const CompactTree *, NodeIndex, void *),
+                     void (*postProc)(const CompactTree *, NodeIndex, void *),
+                     void *arg)
+{
+  while (n != NO_NODE)
+  {
+    int i;
+    if (preProc != NULL)
+      preProc(ct, n, arg);
+    for (i = 0; i < MAXCHILDREN; i++)
+      compactTraverse(ct, compactChild(ct, n, i), preProc, postProc, arg);
+    if (postProc != NULL)
+      postProc(ct, n, arg);
+    n = ct->nodes[n].sibling;
+  }
+}
+
+/* printing: indentation is kept in the traversal
+ * argument, one step per child level
+ */
+static void printPre(const CompactTree *ct, NodeIndex n, void *arg)
+{
+  const CompactNode *c = &ct->nodes[n];
+  int *indent = (int *)arg;
+  TreeNode t;
+  int i;
+
+  for (i = 0; i < *indent; i++)
+    fprintf(listing, " ");
+  memset(&t, 0, sizeof(t));
+  t.nodekind = COMPACT_KIND(c);
+  t.type = COMPACT_TYPE(c);
+  t.flag = COMPACT_FLAG(c);
+  t.op = c->p[0];
+  t.val = (int)c->p[0];
+  t.name = compactName(ct, n);
+  printNode(&t);
+  *indent += 2;
+}
+
+static void printPost(const CompactTree *ct, NodeIndex n, void *arg)
+{
+  (void)ct;
+  (void)n;
+  *(int *)arg -= 2;
+}
+
+void printCompactTree(const CompactTree *ct)
+{
+  int indent = 2;
+  compactTraverse(ct, ct->root, printPre, printPost, &indent);
+}
@@ -0,0 +1,97 @@
+/****************************************************/
+/* File: compact.h                                  */
+/* Compact index-based syntax tree interface        */
+/* for the C-MINUS compiler                         */
+/****************************************************/
+
+#ifndef _COMPACT_H_
+#define _COMPACT_H_
+
+/* NodeIndex is a 32-bit index into the node array;
+ * index 0 is never used and means "no node"
+ */
+typedef unsigned int NodeIndex;
+#define NO_NODE 0
+
+/* NO_ATOM marks a node without a name */
+#define NO_ATOM 0xFFFFFFFFu
+
+/* A CompactNode packs kind, type, flag and line
+ * number into one word and keeps the column of a
+ * name in another; the three payload words depend
+ * on the kind:
+ *   SelectStmtK           p[0..2] = child[0..2]
+ *   OpK                   p[0] = op,   p[1..2] = child[0..1]
+ *   ConstK                p[0] = val
+ *   named kinds           p[0] = atom id, p[1..2] = child[0..1]
+ *   other kinds           p[1..2] = child[0..1]
+ * The nodes of a tree are laid out in preorder
+ */
+typedef struct
+{
+  unsigned int info; /* kind:4 type:3 flag:1 lineno:24 */
+  unsigned int column; /* of the name, 0 if unknown */
+  NodeIndex sibling;
+  unsigned int p[3];
+} CompactNode;
+
+#define COMPACT_KIND(n) ((NodeKind)((n)->info & 0xF))
+#define COMPACT_TYPE(n) ((NodeType)(((n)->info >> 4) & 0x7))
+#define COMPACT_FLAG(n) (((n)->info >> 7) & 0x1)
+#define COMPACT_LINENO(n) ((int)((n)->info >> 8))
+
+typedef struct
+{
+  CompactNode *nodes; /* nodes[1..size-1] */
+  int size;
+  int capacity;
+  NodeIndex root;
+} CompactTree;
+
+/* Function compactTree converts a syntax tree to
+ * the compact form
+ */
+CompactTree *compactTree(TreeNode *tree);
+
+/* Function expandCompactTree rebuilds TreeNodes
+ * from the compact form in a single pass, all in one
+ * contiguous block of astArena, in preorder
+ */
+TreeNode *expandCompactTree(const CompactTree *ct);
+
+/* Function expandCompactTreeNames is expandCompactTree
+ * for nodes whose name words index the given table
+ * instead of the atom table
+ */
+TreeNode *expandCompactTreeNames(const CompactTree *ct, char **names);
+
+/* Function validCompactTree checks a compact tree
+ * read from outside before it is expanded: it must
+ * be one tree in preorder, shaped as the grammar
+ * builds it, its kinds, types and operators must
+ * exist and its name words must be below nameCount
+ */
+int validCompactTree(const CompactTree *ct, unsigned int nameCount);
+
+void freeCompactTree(CompactTree *ct);
+
+/* traversal helpers */
+NodeIndex compactChild(const CompactTree *ct, NodeIndex n, int i);
+NodeIndex compactSibling(const CompactTree *ct, NodeIndex n);
+char *compactName(const CompactTree *ct, NodeIndex n);
+
+/* Procedure compactTraverse applies preProc in
+ * preorder and postProc in postorder to every node
+ * of the list starting at n (either may be NULL)
+ */
+void compactTraverse(const CompactTree *ct, NodeIndex n,
+                     void (*preProc)(const CompactTree *, NodeIndex, void *),
+                     void (*postProc)(const CompactTree *, NodeIndex, void *),
+                     void *arg);
+
+/* procedure printCompactTree prints a compact tree
+ * exactly as printTree prints the syntax tree
+ */
+void printCompactTree(const CompactTree *ct);
+
+#endif
@@ -52,11 +52,16 @@
  */
 typedef int TokenType;
 
-extern FILE *source;  /* source code text file */
-extern FILE *listing; /* listing output text file */
-extern FILE *code;    /* code text file for TM simulator */
+/* The state of a compilation, these variables and
+ * those of the phases included, is thread-local:
+ * each thread compiles a file of its own (see
+ * compile in main.c)
+ */
+extern _Thread_local FILE *source;  /* source code text file */
+extern _Thread_local FILE *listing; /* listing output text file */
+extern _Thread_local FILE *code;    /* code text file for TM simulator */
 
-extern int lineno; /* source line number for listing */
+extern _Thread_local int lineno; /* source line number for listing */
 
 /**************************************************/
 /***********   Syntax tree for parsing ************/
@@ -92,12 +97,14 @@ typedef enum
 #define MAXCHILDREN 3
 
 struct ScopeListRec;
+struct BucketListRec;
 
 typedef struct treeNode
 {
    struct treeNode *child[MAXCHILDREN];
    struct treeNode *sibling;
    int lineno;
+   int column; /* of the name, 0 if unknown */
 
    /* StmtKind, ExpKind를 NodeKind로 통합 */
    NodeKind nodekind;
@@ -108,7 +115,7 @@ typedef struct treeNode
    /* union attr 멤버 그대로 사용 (Stmt, Exp 통합) */
    TokenType op;
    int val;
-   char *name;
+   char *name; /* interned (atom.h): equal names are the same pointer */
 
    /* 1. If Statement: <-> If-Else Statment:
     * 2. Non-value Return Statement <-> Return Statement:
@@ -116,6 +123,22 @@ typedef struct treeNode
    int flag;
 
    struct ScopeListRec *scope;
+
+   /* VarExpK, CallK, AssignK (its target): the symbol
+    * table entry the name resolved to, RetStmtK: the
+    * entry of its function; set when the symbol table
+    * is built, so no later pass looks a name up again.
+    * The entry holds the declaring node, its depth
+    * and memory location */
+   struct BucketListRec *bind;
+
+   /* FunDeclK with lazy parsing: token index of the
+    * unparsed body's LCURLY, 0 once it is parsed */
+   int body;
+
+   /* id of a node shared by hash-consing (hashcons.h),
+    * 0 for other nodes */
+   int id;
 } TreeNode;
 
 /**************************************************/
@@ -126,30 +149,30 @@ typedef struct treeNode
  * be echoed to the listing file with line numbers
  * during parsing
  */
-extern int EchoSource;
+extern _Thread_local int EchoSource;
 
 /* TraceScan = TRUE causes token information to be
  * printed to the listing file as each token is
  * recognized by the scanner
  */
-extern int TraceScan;
+extern _Thread_local int TraceScan;
 
 /* TraceParse = TRUE causes the syntax tree to be
  * printed to the listing file in linearized form
  * (using indents for children)
  */
-extern int TraceParse;
+extern _Thread_local int TraceParse;
 
 /* TraceAnalyze = TRUE causes symbol table inserts
  * and lookups to be reported to the listing file
  */
-extern int TraceAnalyze;
+extern _Thread_local int TraceAnalyze;
 
 /* TraceCode = TRUE causes comments to be written
  * to the TM code file as code is generated
  */
-extern int TraceCode;
+extern _Thread_local int TraceCode;
 
 /* Error = TRUE prevents further passes if an error occurs */
-extern int Error;
+extern _Thread_local int Error;
 #endif
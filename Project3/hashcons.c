@@ -0,0 +1,149 @@
+/****************************************************/
+/* File: hashcons.c                                 */
+/* Hash-consing of expression subtrees for the      */
+/* C-MINUS compiler                                 */
+/****************************************************/
+
+#include "globals.h"
+#include "traverse.h"
+#include "hashcons.h"
+
+/* open addressing table of the shared nodes; its
+ * size is a power of two, kept at most half full
+ */
+static _Thread_local TreeNode **table = NULL;
+static _Thread_local unsigned int tableSize = 0;
+static _Thread_local int count = 0;    /* distinct shared nodes */
+static _Thread_local int replaced = 0; /* nodes replaced by hashConsTree */
+
+static int consable(TreeNode *t)
+{
+  if (t->sibling != NULL)
+    return FALSE;
+  switch (t->nodekind)
+  {
+  case OpK:
+  case ConstK:
+    return TRUE;
+  case VarExpK:
+    /* names in different scopes differ in the entry */
+    return t->bind != NULL;
+  default:
+    return FALSE;
+  }
+}
+
+static unsigned int hashNode(TreeNode *t)
+{
+  unsigned long h = t->nodekind;
+  int i;
+  h = h * 31 + t->type;
+  h = h * 31 + t->op;
+  h = h * 31 + t->val;
+  h = h * 31 + (unsigned long)t->bind;
+  for (i = 0; i < MAXCHILDREN; i++)
+    h = h * 31 + (unsigned long)t->child[i];
+  return (unsigned int)(h ^ (h >> 29));
+}
+
+/* children are compared by pointer, since they have
+ * been shared before their parent
+ */
+static int sameNode(TreeNode *a, TreeNode *b)
+{
+  int i;
+  if (a->nodekind != b->nodekind || a->type != b->type || a->op != b->op ||
+      a->val != b->val || a->name != b->name || a->bind != b->bind ||
+      a->flag != b->flag)
+    return FALSE;
+  for (i = 0; i < MAXCHILDREN; i++)
+    if (a->child[i] != b->child[i])
+      return FALSE;
+  return TRUE;
+}
+
+static void growTable(void)
+{
+  TreeNode **old = table;
+  unsigned int oldSize = tableSize, i;
+  tableSize = tableSize ? 2 * tableSize : 1024;
+  table = (TreeNode **)calloc(tableSize, sizeof(TreeNode *));
+  if (table == NULL)
+  {
+    fprintf(stderr, "Out of memory in hash-consing\n");
+    exit(1);
+  }
+  for (i = 0; i < oldSize; i++)
+    if (old[i] != NULL)
+    {
+      unsigned int j = hashNode(old[i]) & (tableSize - 1);
+      while (table[j] != NULL)
+        j = (j + 1) & (tableSize - 1);
+      table[j] = old[i];
+    }
+  free(old);
+}
+
+/* share returns the shared node equal to t,
+ * entering t if there is none yet
+ */
+static TreeNode *share(TreeNode *t)
+{
+  unsigned int j;
+  if (!consable(t))
+    return t;
+  if (2 * (count + 1) > (int)tableSize)
+    growTable();
+  j = hashNode(t) & (tableSize - 1);
+  while (table[j] != NULL)
+  {
+    if (table[j] == t)
+      return t;
+    if (sameNode(table[j], t))
+    {
+      replaced++;
+      return table[j];
+    }
+    j = (j + 1) & (tableSize - 1);
+  }
+  table[j] = t;
+  t->id = ++count;
+  return t;
+}
+
+/* in postorder the children of t are complete, so
+ * the last node of each child list can be shared
+ */
+static void shareChildren(TreeNode *t)
+{
+  int i;
+  for (i = 0; i < MAXCHILDREN; i++)
+  {
+    TreeNode **p = &t->child[i];
+    while (*p != NULL && (*p)->sibling != NULL)
+      p = &(*p)->sibling;
+    if (*p != NULL)
+      *p = share(*p);
+  }
+}
+
+int hashConsTree(TreeNode *tree)
+{
+  int before = replaced;
+  traverse(tree, NULL, shareChildren);
+  return replaced - before;
+}
+
+int hashConsCount(void)
+{
+  return count;
+}
+
+void freeHashCons(void)
+{
+  free(table);
+  table = NULL;
+  tableSize = 0;
+  count = 0;
+  replaced = 0;
+}
@@ -0,0 +1,36 @@
+/****************************************************/
+/* File: hashcons.h                                 */
+/* Hash-consing of expression subtrees for the      */
+/* C-MINUS compiler                                 */
+/****************************************************/
+
+#ifndef _HASHCONS_H_
+#define _HASHCONS_H_
+
+/* Function hashConsTree makes structurally equal
+ * side-effect-free expressions in an analyzed syntax
+ * tree share one node: OpK, ConstK and VarExpK nodes
+ * with equal attributes, type, symbol table entry and
+ * (already shared) children. Only the last node of a
+ * sibling list can be shared, since the others differ
+ * in their sibling. A shared node keeps the line
+ * number of its first occurrence and gets a stable id
+ * (1, 2, ... in postorder of first occurrence); other
+ * nodes have id 0. Returns the number of nodes that
+ * were replaced by a shared one. The replaced nodes
+ * are not reclaimed: they stay in astArena with the
+ * rest of the tree
+ */
+int hashConsTree(TreeNode *tree);
+
+/* Function hashConsCount returns the number of
+ * distinct shared nodes
+ */
+int hashConsCount(void);
+
+/* Procedure freeHashCons releases the table; the
+ * nodes themselves stay in astArena
+ */
+void freeHashCons(void);
+
+#endif
@@ -5,6 +5,11 @@
 /* Kenneth C. Louden                                */
 /****************************************************/
 
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "globals.h"
 
 /* set NO_PARSE to TRUE to get a scanner-only compiler */
@@ -18,6 +23,16 @@
 #define NO_CODE TRUE // TRUE로 설정하여 Code Generation을 실행하지 않음
 
 #include "util.h"
+#include "tokenize.h"
+#include "arena.h"
+#include "atom.h"
+#include "compact.h"
+#include "astcache.h"
+#include "pipeline.h"
+#include "hashcons.h"
+#include "symtab.h"
+#include "xref.h"
+#include "server.h"
 #if NO_PARSE
 #include "scan.h"
 #else
@@ -31,61 +46,329 @@
 #endif
 
 /* allocate global variables */
-int lineno = 0;
-FILE *source;
-FILE *listing;
-FILE *code;
+_Thread_local int lineno = 0;
+_Thread_local FILE *source;
+_Thread_local FILE *listing;
+_Thread_local FILE *code;
 
-/* allocate and set tracing flags */
-int EchoSource = FALSE;
-int TraceScan = FALSE;    // Analyzer를 위해 FALSE로 변경
-int TraceParse = FALSE;   // Analyzer를 위해 FALSE로 변경
-int TraceAnalyze = FALSE; // Symbol Table 출력시 TRUE로 변경
-int TraceCode = FALSE;
+/* allocate and set tracing flags (the main
+ * thread's are the defaults of every compilation)
+ */
+_Thread_local int EchoSource = FALSE;
+_Thread_local int TraceScan = FALSE;    // Analyzer를 위해 FALSE로 변경
+_Thread_local int TraceParse = FALSE;   // Analyzer를 위해 FALSE로 변경
+_Thread_local int TraceAnalyze = FALSE; // Symbol Table 출력시 TRUE로 변경
+_Thread_local int TraceCode = FALSE;
 
-int Error = FALSE;
+_Thread_local int Error = FALSE;
 
-main(int argc, char *argv[])
+/* A CompileContext is one compilation: the source
+ * file, where its listing goes and the options it
+ * was given. The phases keep their state in
+ * thread-local variables, so each thread is a
+ * compiler of its own: compile sets the calling
+ * thread's from the context and runs the phases
+ */
+typedef struct
 {
-  TreeNode *syntaxTree;
-  char pgm[120]; /* source code file name */
-  if (argc != 2)
+  char pgm[120]; /* source code file name, "-" for the text */
+  const char *dir;   /* of relative paths, NULL for the current one */
+  const char *text;  /* the source read from standard input */
+  int textLength;
+  FILE *listing;
+  FILE *errors;      /* the compiler's messages */
+  int echoSource, traceScan, traceParse, traceAnalyze, traceCode;
+  int parallelScan;     /* -p: scan the source on several threads */
+  int memoryStats;      /* -m: print arena statistics */
+  int compactAst;       /* -a: print and measure the compact syntax tree */
+  int descentParse;     /* -r: use the recursive-descent parser */
+  int streamAnalysis;   /* -s: analyze each declaration once parsed */
+  int lazyParse;        /* -l: parse function bodies when needed */
+  int outlineOnly;      /* -o: print the global declarations only */
+  int pipelined;        /* -t: scan on a second thread */
+  int shareExpressions; /* -h: hash-cons expression subtrees */
+  int shadowStacks;     /* -g: one symbol table with shadow stacks */
+  int printIndex;       /* -x: print the cross-reference index */
+  char *symtabFile;     /* -y file: write the symbol table for tools */
+  int analysisThreads;  /* -j n: analyze function bodies on n threads */
+  int watch;            /* -w: compile again when the source changes */
+  char *astCacheDir;    /* -c dir: syntax tree cache */
+  int scanBuffer;       /* scan into a token array, not with flex */
+  int warm;             /* keep the arenas' chunks for the next one */
+  int found;            /* set by compile: the source could be opened */
+  int error;            /* set by compile: Error */
+  char *listingText;    /* the listing, when kept in memory */
+  size_t listingSize;
+} CompileContext;
+
+#if !NO_PARSE && !NO_ANALYZE
+/* streamDeclaration analyzes each top-level
+ * declaration as soon as it is parsed and then
+ * releases its syntax tree, so memory follows the
+ * largest declaration rather than the whole file
+ */
+static void streamDeclaration(TreeNode *t)
+{
+  analyzeDeclaration(t);
+  arenaFree(&astArena);
+}
+
+/* sameStat tells whether two stats of a file show
+ * the same modification
+ */
+static int sameStat(const struct stat *a, const struct stat *b)
+{
+  return a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec &&
+         a->st_size == b->st_size;
+}
+
+/* nextSource waits until the file pgm differs from
+ * *last, and then until it stays the same for one
+ * poll, so that a file being written is not read
+ * half way; it returns the new text
+ */
+static char *nextSource(char *pgm, struct stat *last, int *length)
+{
+  struct stat pending = *last;
+  for (;;)
   {
-    fprintf(stderr, "usage: %s <filename>\n", argv[0]);
-    exit(1);
+    struct timespec pause = {0, 200000000};
+    struct stat now;
+    FILE *file;
+    nanosleep(&pause, NULL);
+    if (stat(pgm, &now) != 0 || sameStat(&now, last))
+      continue;
+    if (!sameStat(&now, &pending))
+    {
+      pending = now;
+      continue;
+    }
+    file = fopen(pgm, "r");
+    if (file == NULL)
+      continue;
+    *last = now;
+    {
+      char *text = readSource(file, length);
+      fclose(file);
+      return text;
+    }
   }
-  strcpy(pgm, argv[1]);
-  if (strchr(pgm, '.') == NULL)
-    strcat(pgm, ".tny");
-  source = fopen(pgm, "r");
+}
+
+/* watchSource compiles the source again each time
+ * the file changes (-w): the edited part of the text
+ * is lexed again, the whole is parsed by the
+ * recursive-descent parser, and the functions that
+ * did not change, nor the globals they use, keep
+ * their analysis. It does not return
+ */
+static void watchSource(char *pgm, int printIndex, char *symtabFile)
+{
+  int length;
+  char *text = readSource(source, &length);
+  TokenArray *tokens = scanBuffer(text, length);
+  struct stat last;
+
+  stat(pgm, &last);
+  for (;;)
+  {
+    TreeNode *syntaxTree;
+    int newLength, prefix = 0, suffix = 0;
+    char *newText;
+
+    Error = FALSE;
+    useTokenArray(tokens);
+    syntaxTree = rdParse();
+    if (!Error)
+    {
+      if (TraceAnalyze)
+        fprintf(listing, "\nBuilding Symbol Table...\n");
+      analyzeIncremental(syntaxTree);
+      if (TraceAnalyze)
+        fprintf(listing, "\nType Checking Finished\n");
+    }
+    if (symtabFile != NULL && !writeSymtabFile(symtabFile))
+      fprintf(stderr, "Cannot write symbol table file %s\n", symtabFile);
+    if (printIndex)
+    {
+      fprintf(listing, "\n");
+      printXref(listing);
+      freeXref();
+    }
+    fflush(listing);
+    release_scopes(0);
+    arenaFree(&symtabArena);
+    arenaFree(&astArena);
+
+    newText = nextSource(pgm, &last, &newLength);
+    while (prefix < length && prefix < newLength && text[prefix] == newText[prefix])
+      prefix++;
+    while (suffix < length - prefix && suffix < newLength - prefix &&
+           text[length - 1 - suffix] == newText[newLength - 1 - suffix])
+      suffix++;
+    {
+      char *edited = relexTokens(tokens, prefix, length - prefix - suffix, newText + prefix,
+                                 newLength - prefix - suffix, NULL);
+      free(text);
+      free(newText);
+      text = edited;
+      length = newLength;
+    }
+    fprintf(listing, "\nC-MINUS COMPILATION: %s\n", pgm);
+  }
+}
+#endif
+
+/* localPath returns the path the compiler opens for
+ * name: relative to c->dir if that is set
+ */
+static const char *localPath(const CompileContext *c, const char *name, char *buf, size_t size)
+{
+  if (c->dir == NULL || name == NULL || name[0] == '/')
+    return name;
+  snprintf(buf, size, "%s/%s", c->dir, name);
+  return buf;
+}
+
+/* compile runs the compilation c on the calling
+ * thread. The state a compilation leaves behind on
+ * the thread (the atoms apart) is released, so the
+ * thread can compile another file next
+ */
+static void compile(CompileContext *c)
+{
+  TreeNode *syntaxTree;
+  char *pgm = c->pgm;
+  int descentParse = c->descentParse;
+  int sharedNodes = 0;
+  CompactTree *ct = NULL;
+  TokenArray *tokens = NULL;
+  char *text = NULL;
+  char path[1024], symtabPath[1024], cachePath[1024];
+  const char *symtabFile = localPath(c, c->symtabFile, symtabPath, sizeof(symtabPath));
+
+  EchoSource = c->echoSource;
+  TraceScan = c->traceScan;
+  TraceParse = c->traceParse;
+  TraceAnalyze = c->traceAnalyze;
+  TraceCode = c->traceCode;
+  shadowStacks = c->shadowStacks;
+  xrefIndex = c->printIndex || c->symtabFile != NULL; /* the file has the uses */
+  astCacheDir = (char *)localPath(c, c->astCacheDir, cachePath, sizeof(cachePath));
+  lazyBodies = FALSE;
+  declarationProc = NULL;
+  scopeArena = NULL;
+  lineno = 0;
+  Error = FALSE;
+  listing = c->listing;
+  if (c->text != NULL)
+    source = fmemopen((void *)c->text, c->textLength, "r");
+  else
+    source = fopen(localPath(c, pgm, path, sizeof(path)), "r");
+  c->found = source != NULL;
   if (source == NULL)
   {
-    fprintf(stderr, "File %s not found\n", pgm);
-    exit(1);
+    fprintf(c->errors, "File %s not found\n", pgm);
+    return;
   }
-  listing = stdout; /* send listing to screen */
   fprintf(listing, "\nC-MINUS COMPILATION: %s\n", pgm);
+#if !NO_PARSE && !NO_ANALYZE
+  if (c->watch)
+  {
+    watchSource(pgm, c->printIndex, c->symtabFile);
+    return;
+  }
+#endif
+  if (c->parallelScan || c->lazyParse || (c->scanBuffer && !c->pipelined))
+  {
+    int length;
+    text = readSource(source, &length);
+    tokens = c->parallelScan ? scanParallel(text, length, 0) : scanBuffer(text, length);
+    useTokenArray(tokens);
+  }
+  if (c->lazyParse)
+  {
+    /* bodies are skipped over the token array and
+     * parsed by the recursive-descent parser
+     */
+    descentParse = TRUE;
+    lazyBodies = TRUE;
+  }
 #if NO_PARSE
   while (getToken() != ENDFILE)
     ;
 #else
-  syntaxTree = parse();
+#if !NO_ANALYZE
+  if (c->streamAnalysis && !c->outlineOnly)
+  {
+    if (TraceAnalyze)
+      fprintf(listing, "\nAnalyzing Declarations...\n");
+    beginAnalysis();
+    declarationProc = streamDeclaration;
+  }
+#endif
+  if (descentParse)
+    syntaxTree = rdParse();
+  else if (c->pipelined && !c->parallelScan)
+    syntaxTree = pipelineParse(source);
+  else
+    syntaxTree = parse();
+  if (c->compactAst && !c->lazyParse && !Error)
+  {
+    /* the analyzer annotates TreeNodes in place, so
+     * it keeps the parser's tree; the compact form is
+     * printed and measured (-m) next to it
+     */
+    ct = compactTree(syntaxTree);
+  }
   if (TraceParse)
   {
     fprintf(listing, "\nSyntax tree:\n");
+    if (ct != NULL)
+      printCompactTree(ct);
+    else
+      printTree(syntaxTree);
+  }
+  if (c->outlineOnly && !Error)
+  {
+    fprintf(listing, "\nOutline:\n");
     printTree(syntaxTree);
   }
 #if !NO_ANALYZE
-  if (!Error)
+  if (c->outlineOnly)
+    ;
+  else if (c->streamAnalysis)
   {
+    endAnalysis();
     if (TraceAnalyze)
-      fprintf(listing, "\nBuilding Symbol Table...\n");
-    buildSymtab(syntaxTree);
+      fprintf(listing, "\nType Checking Finished\n");
+  }
+  /* a whole-program analysis needs every body, and
+   * a syntax error in one stops it before it starts
+   */
+  else if (!Error && (!c->lazyParse || parseBodies(syntaxTree)))
+  {
     if (TraceAnalyze)
-      fprintf(listing, "\nChecking Types...\n");
-    typeCheck(syntaxTree);
+      fprintf(listing, "\nBuilding Symbol Table...\n");
+    if (c->analysisThreads > 1)
+      analyzeParallel(syntaxTree, c->analysisThreads);
+    else
+      analyze(syntaxTree);
     if (TraceAnalyze)
       fprintf(listing, "\nType Checking Finished\n");
+    /* sharing needs the types and entries of the
+     * analysis, and keeps its diagnostics per node
+     */
+    if (c->shareExpressions)
+      sharedNodes = hashConsTree(syntaxTree);
+  }
+  if (symtabFile != NULL && !c->outlineOnly && !writeSymtabFile(symtabFile))
+    fprintf(c->errors, "Cannot write symbol table file %s\n", c->symtabFile);
+  if (c->printIndex && !c->outlineOnly)
+  {
+    fprintf(listing, "\n");
+    printXref(listing);
+    freeXref();
   }
 #if !NO_CODE
   if (!Error)
@@ -95,7 +378,7 @@ main(int argc, char *argv[])
     codefile = (char *)calloc(fnlen + 4, sizeof(char));
     strncpy(codefile, pgm, fnlen);
     strcat(codefile, ".tm");
-    code = fopen(codefile, "w");
+    code = fopen(localPath(c, codefile, path, sizeof(path)), "w");
     if (code == NULL)
     {
       printf("Unable to open %s\n", codefile);
@@ -103,10 +386,332 @@ main(int argc, char *argv[])
     }
     codeGen(syntaxTree, codefile);
     fclose(code);
+    free(codefile);
   }
 #endif
 #endif
 #endif
+  if (c->memoryStats)
+  {
+    fprintf(listing, "\nMemory:\n");
+    printArenaStats(listing, &astArena);
+    printArenaStats(listing, &symtabArena);
+    printArenaStats(listing, &atomArena);
+    printArenaStats(listing, &localArena);
+    if (ct != NULL)
+      fprintf(listing, "%-13s  %10d nodes        %10lu bytes\n", "compact tree",
+              ct->size - 1, (unsigned long)(ct->size * sizeof(CompactNode)));
+    if (c->shareExpressions)
+      /* sharing runs after the tree is built, so the
+       * nodes it replaces stay in the syntax tree arena
+       */
+      fprintf(listing, "%-13s  %10d nodes        %10d replaced  %10lu bytes not reclaimed\n",
+              "shared exprs", hashConsCount(), sharedNodes,
+              (unsigned long)(sharedNodes * sizeof(TreeNode)));
+  }
+  c->error = Error;
+  freeCompactTree(ct);
+  freeHashCons();
+  useTokenArray(NULL);
+  freeTokenArray(tokens);
+  free(text);
+  /* each phase's memory goes in one call */
+  release_scopes(0);
+  if (c->warm)
+  {
+    /* and the names, or a server's table would keep
+     * those of every file it ever compiled
+     */
+    arenaReset(&symtabArena);
+    arenaReset(&astArena);
+    resetAtoms();
+  }
+  else
+  {
+    arenaFree(&symtabArena);
+    arenaFree(&astArena);
+  }
   fclose(source);
-  return 0;
+}
+
+/* A Pool compiles its contexts on threads that take
+ * them one by one, in order, each listing kept in
+ * memory until all are done
+ */
+typedef struct
+{
+  CompileContext *contexts;
+  int count;
+  atomic_int next;
+} Pool;
+
+static void *compileThread(void *arg)
+{
+  Pool *pool = (Pool *)arg;
+  for (;;)
+  {
+    int i = atomic_fetch_add(&pool->next, 1);
+    CompileContext *c;
+    if (i >= pool->count)
+      break;
+    c = &pool->contexts[i];
+    c->listing = open_memstream(&c->listingText, &c->listingSize);
+    if (c->listing == NULL)
+    {
+      fprintf(stderr, "Out of memory for the listing of %s\n", c->pgm);
+      exit(1);
+    }
+    compile(c);
+    fclose(c->listing);
+  }
+  /* the thread's memory ends with it */
+  free_scopes();
+  arenaFree(&astArena);
+  arenaFree(&symtabArena);
+  arenaFree(&localArena);
+  freeAtoms();
+  return NULL;
+}
+
+/* compileFiles compiles count contexts on up to
+ * threads threads (0 = number of online CPUs) and
+ * prints their listings to out in order
+ */
+static void compileFiles(CompileContext *contexts, int count, int threads, FILE *out)
+{
+  Pool pool;
+  pthread_t *ids;
+  int i;
+
+  if (threads <= 0)
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (threads > count)
+    threads = count;
+  if (threads < 1)
+    threads = 1;
+  pool.contexts = contexts;
+  pool.count = count;
+  atomic_init(&pool.next, 0);
+  ids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+  if (ids == NULL)
+  {
+    fprintf(stderr, "Out of memory starting the compile threads\n");
+    exit(1);
+  }
+  for (i = 0; i < threads; i++)
+    if (pthread_create(&ids[i], NULL, compileThread, &pool) != 0)
+    {
+      fprintf(stderr, "Cannot start a compile thread\n");
+      exit(1);
+    }
+  for (i = 0; i < threads; i++)
+    pthread_join(ids[i], NULL);
+  free(ids);
+  for (i = 0; i < count; i++)
+  {
+    fwrite(contexts[i].listingText, 1, contexts[i].listingSize, out);
+    free(contexts[i].listingText);
+  }
+}
+
+/* the options of a command line that are not those
+ * of a compilation
+ */
+typedef struct
+{
+  int fileThreads;  /* -f n: compile the files on n threads */
+  char *socketPath; /* -S socket: serve compile requests, "-" on serverPath() */
+} DriverOptions;
+
+static void usage(FILE *err, char *name)
+{
+  fprintf(err, "usage: %s [-p] [-m] [-a] [-r] [-s] [-l] [-o] [-t] [-h] [-g] [-x] [-y file] [-j n] [-w] [-f n] [-S socket] [-c dir] <filename>...\n", name);
+}
+
+/* parseOptions sets options and driver from the
+ * options of a command line and returns the index of
+ * its first file name
+ */
+static int parseOptions(int argc, char *argv[], CompileContext *options, DriverOptions *driver)
+{
+  int argi;
+  driver->fileThreads = -1;
+  driver->socketPath = NULL;
+  for (argi = 1; argi < argc && argv[argi][0] == '-' && argv[argi][1] != '\0'; argi++)
+  {
+    if (strcmp(argv[argi], "-p") == 0)
+      options->parallelScan = TRUE;
+    else if (strcmp(argv[argi], "-m") == 0)
+      options->memoryStats = TRUE;
+    else if (strcmp(argv[argi], "-a") == 0)
+      options->compactAst = TRUE;
+    else if (strcmp(argv[argi], "-r") == 0)
+      options->descentParse = TRUE;
+    else if (strcmp(argv[argi], "-s") == 0)
+      options->streamAnalysis = TRUE;
+    else if (strcmp(argv[argi], "-l") == 0)
+      options->lazyParse = TRUE;
+    else if (strcmp(argv[argi], "-o") == 0)
+      options->outlineOnly = options->lazyParse = TRUE;
+    else if (strcmp(argv[argi], "-t") == 0)
+      options->pipelined = TRUE;
+    else if (strcmp(argv[argi], "-h") == 0)
+      options->shareExpressions = TRUE;
+    else if (strcmp(argv[argi], "-g") == 0)
+      options->shadowStacks = TRUE;
+    else if (strcmp(argv[argi], "-x") == 0)
+      options->printIndex = TRUE;
+    else if (strcmp(argv[argi], "-y") == 0 && argi + 1 < argc)
+      options->symtabFile = argv[++argi];
+    else if (strcmp(argv[argi], "-w") == 0)
+      options->watch = TRUE;
+    else if (strcmp(argv[argi], "-j") == 0 && argi + 1 < argc)
+      options->analysisThreads = atoi(argv[++argi]);
+    else if (strcmp(argv[argi], "-f") == 0 && argi + 1 < argc)
+      driver->fileThreads = atoi(argv[++argi]);
+    else if (strcmp(argv[argi], "-S") == 0 && argi + 1 < argc)
+      driver->socketPath = argv[++argi];
+    else if (strcmp(argv[argi], "-c") == 0 && argi + 1 < argc)
+      options->astCacheDir = argv[++argi];
+    else
+      break;
+  }
+  return argi;
+}
+
+/* compileCommand compiles the files of a command
+ * line, names[0..files), with options. A "-" file is
+ * text, or standard input if text is NULL. The files
+ * are compiled on the calling thread, or on a pool of
+ * threads with -f n or several files (unless warm:
+ * the server's threads keep their memory). Returns
+ * the exit status
+ */
+static int compileCommand(CompileContext *options, DriverOptions *driver, char *name,
+                          int files, char *names[], const char *text, int textLength,
+                          FILE *out, FILE *err, int warm)
+{
+  CompileContext *contexts;
+  char *input = NULL;
+  int i, missing = 0;
+
+  /* one file only for what outlives the compilation,
+   * and a file to watch, not standard input
+   */
+  if (files < 1 || (files > 1 && (options->watch || options->symtabFile != NULL)) ||
+      (options->watch && strcmp(names[0], "-") == 0))
+  {
+    usage(err, name);
+    return 1;
+  }
+  contexts = (CompileContext *)calloc(files, sizeof(CompileContext));
+  if (contexts == NULL)
+  {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  for (i = 0; i < files; i++)
+  {
+    CompileContext *c = &contexts[i];
+    *c = *options;
+    strncpy(c->pgm, names[i], sizeof(c->pgm) - 5);
+    if (strcmp(c->pgm, "-") == 0)
+    {
+      if (text == NULL)
+        text = input = readSource(stdin, &textLength);
+      c->text = text;
+      c->textLength = textLength;
+    }
+    else if (strchr(c->pgm, '.') == NULL)
+      strcat(c->pgm, ".tny");
+    c->errors = err;
+  }
+  if (driver->fileThreads < 0 && (files == 1 || warm))
+    for (i = 0; i < files; i++)
+    {
+      /* the flex scanner is not reentrant, and the
+       * server's threads compile one file after another
+       */
+      contexts[i].scanBuffer = warm;
+      contexts[i].listing = out;
+      contexts[i].warm = warm;
+      compile(&contexts[i]);
+    }
+  else
+  {
+    /* and several of the pool's threads scan at once */
+    for (i = 0; i < files; i++)
+      contexts[i].scanBuffer = TRUE;
+    compileFiles(contexts, files, driver->fileThreads, out);
+  }
+  for (i = 0; i < files; i++)
+    missing += !contexts[i].found;
+  free(contexts);
+  free(input);
+  return missing > 0;
+}
+
+/* the options the server was started with, the
+ * defaults of its requests
+ */
+static CompileContext serverOptions;
+
+/* serveRequest runs a command line sent to the
+ * server, with its paths in the client's directory
+ */
+static int serveRequest(ServerRequest *request, FILE *out, FILE *err)
+{
+  CompileContext options = serverOptions;
+  DriverOptions driver;
+  int argi = parseOptions(request->argc, request->argv, &options, &driver);
+  /* a server does not start another one, nor wait */
+  if (driver.socketPath != NULL || options.watch)
+  {
+    usage(err, request->argv[0]);
+    return 1;
+  }
+  options.dir = request->dir;
+  return compileCommand(&options, &driver, request->argv[0], request->argc - argi,
+                        request->argv + argi, request->text, request->textLength,
+                        out, err, TRUE);
+}
+
+main(int argc, char *argv[])
+{
+  CompileContext options;
+  DriverOptions driver;
+  int argi;
+
+  memset(&options, 0, sizeof(options));
+  options.echoSource = EchoSource;
+  options.traceScan = TraceScan;
+  options.traceParse = TraceParse;
+  options.traceAnalyze = TraceAnalyze;
+  options.traceCode = TraceCode;
+  argi = parseOptions(argc, argv, &options, &driver);
+  if (driver.socketPath != NULL)
+  {
+    /* the options given with -S apply to every
+     * request, -f n is the number of threads;
+     * -S - listens where cmclient looks by default
+     */
+    const char *path = driver.socketPath;
+    if (argi != argc || options.watch)
+    {
+      usage(stderr, argv[0]);
+      exit(1);
+    }
+    if (strcmp(path, "-") == 0 && (path = serverPath()) == NULL)
+    {
+      fprintf(stderr, "Cannot find a private directory for the compile server's socket\n");
+      exit(1);
+    }
+    serverOptions = options;
+    serve(path, driver.fileThreads, serveRequest);
+    fprintf(stderr, "Cannot listen on %s\n", path);
+    exit(1);
+  }
+  /* send listing to screen */
+  return compileCommand(&options, &driver, argv[0], argc - argi, argv + argi, NULL, 0,
+                        stdout, stderr, FALSE);
 }
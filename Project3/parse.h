@@ -13,4 +13,44 @@
  */
 TreeNode *parse(void);
 
+/* Function parseTokens runs the parser as a push
+ * parser on the tokens returned by nextToken, which
+ * must set lineno, tokenString and tokenName as
+ * getToken() does
+ */
+TreeNode *parseTokens(TokenType (*nextToken)(void));
+
+/* Function rdParse builds the same tree as
+ * parse() with a hand-written recursive-descent
+ * parser; it returns NULL after a syntax error.
+ * Statements and expressions nested more than 10000
+ * deep are a "memory exhausted" error, as the yacc
+ * parser's are past its stack limit
+ */
+TreeNode *rdParse(void);
+
+/* If declarationProc is set, both parsers pass each
+ * top-level declaration to it as soon as the
+ * declaration is complete instead of collecting
+ * them, and return an empty tree
+ */
+extern _Thread_local void (*declarationProc)(TreeNode *);
+
+/* If lazyBodies is TRUE, rdParse skips function
+ * bodies by brace matching over the installed token
+ * array (see tokenize.h) and records where they
+ * start; parseBody parses the body of a function
+ * when it is needed and returns it, or NULL after a
+ * syntax error (the function is left an empty body)
+ */
+extern _Thread_local int lazyBodies;
+TreeNode *parseBody(TreeNode *fun);
+
+/* Function parseBodies parses the skipped bodies of
+ * the declarations in list, in order, and returns
+ * FALSE at the first syntax error, as the eager
+ * parsers stop there
+ */
+int parseBodies(TreeNode *list);
+
 #endif
@@ -0,0 +1,215 @@
+/****************************************************/
+/* File: pipeline.c                                 */
+/* Pipelined scanning and parsing for the C-MINUS   */
+/* compiler: a scanner thread reads and lexes the   */
+/* source while the parser consumes its tokens      */
+/****************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "parse.h"
+#include "atom.h"
+#include "tokenize.h"
+#include "pipeline.h"
+
+/* number of ring slots, a power of two */
+#define RING_SIZE 4096
+#define RING_MASK (RING_SIZE - 1)
+
+/* the source is read in blocks of this size */
+#define READ_BLOCK (64 * 1024)
+
+/* A PipeToken carries everything the parser takes
+ * from the scanner globals, so that the scanner
+ * thread writes none of them
+ */
+typedef struct
+{
+  TokenType type;
+  int lineno;
+  int column; /* of an ID */
+  char *name; /* interned lexeme of an ID */
+  char lexeme[MAXTOKENLEN + 1];
+} PipeToken;
+
+/* A Pipe joins the scanner thread of one
+ * pipelineParse call to its parser. The scanner
+ * fills ring[head] and then advances head, the
+ * parser reads ring[tail] and then advances tail;
+ * each index has a single writer, so no locks are
+ * needed
+ */
+typedef struct
+{
+  PipeToken ring[RING_SIZE];
+  atomic_uint head;
+  atomic_uint tail;
+  atomic_int stopScanner; /* set when the parser is done */
+  int ended; /* the parser has read ENDFILE */
+  FILE *source;
+  AtomTable atoms; /* the parser's */
+} Pipe;
+
+/* the pipe of the calling thread's parser */
+static _Thread_local Pipe *parserPipe;
+
+/* putToken waits for a free slot and publishes a
+ * token; returns FALSE if the parser has stopped
+ */
+static int putToken(Pipe *p, TokenType type, int lineno, int column, const char *text, int length)
+{
+  unsigned int h = atomic_load_explicit(&p->head, memory_order_relaxed);
+  PipeToken *slot;
+
+  while (h - atomic_load_explicit(&p->tail, memory_order_acquire) == RING_SIZE)
+  {
+    if (atomic_load_explicit(&p->stopScanner, memory_order_relaxed))
+      return FALSE;
+    sched_yield();
+  }
+  slot = &p->ring[h & RING_MASK];
+  slot->type = type;
+  slot->lineno = lineno;
+  slot->column = column;
+  if (length > MAXTOKENLEN)
+    length = MAXTOKENLEN;
+  memcpy(slot->lexeme, text, length);
+  slot->lexeme[length] = '\0';
+  slot->name = type == ID ? internAtom(slot->lexeme, length)->name : NULL;
+  atomic_store_explicit(&p->head, h + 1, memory_order_release);
+  return TRUE;
+}
+
+/* scanSource is the scanner thread. A token is
+ * passed on once a character after it has been read
+ * (or the file has ended), so no token is cut at the
+ * end of a block. Its IDs are interned in the
+ * parser's atom table
+ */
+static void *scanSource(void *arg)
+{
+  Pipe *p = (Pipe *)arg;
+  FILE *file = p->source;
+  char *text = NULL;
+  int size = 0, capacity = 0;
+  int eof = FALSE;
+  int pos = 0, line = 1, lineStart = 0;
+
+  useAtomTable(p->atoms);
+  for (;;)
+  {
+    int q = pos, l = line, s = lineStart, open;
+    Token token;
+    int found = lexToken(text, &q, size, &l, &s, &token, &open);
+
+    if (found && (q < size || eof))
+    {
+      int column = token.type == ID ? token.column : 0;
+      if (!putToken(p, token.type, token.lineno, column, text + token.offset, token.length))
+        break;
+      pos = q;
+      line = l;
+      lineStart = s;
+      continue;
+    }
+    /* blanks are consumed for good, a partial token
+     * or an open comment is scanned again
+     */
+    if (!found && (!open || eof))
+    {
+      pos = q;
+      line = l;
+      lineStart = s;
+    }
+    if (eof)
+    {
+      putToken(p, ENDFILE, line, 0, "", 0);
+      break;
+    }
+    if (capacity - size < READ_BLOCK)
+    {
+      capacity = capacity ? capacity * 2 : 4 * READ_BLOCK;
+      text = (char *)realloc(text, capacity);
+      if (text == NULL)
+      {
+        fprintf(stderr, "Out of memory reading source\n");
+        exit(1);
+      }
+    }
+    {
+      size_t n = fread(text + size, 1, READ_BLOCK, file);
+      size += n;
+      eof = n == 0;
+    }
+  }
+  free(text);
+  return NULL;
+}
+
+/* nextPipedToken is the parser's side of the ring;
+ * it sets the scanner globals from the token, as
+ * getToken() does
+ */
+static TokenType nextPipedToken(void)
+{
+  unsigned int t = atomic_load_explicit(&parserPipe->tail, memory_order_relaxed);
+  PipeToken *slot;
+  TokenType type;
+
+  if (parserPipe->ended)
+    return ENDFILE;
+  while (atomic_load_explicit(&parserPipe->head, memory_order_acquire) == t)
+    sched_yield();
+  slot = &parserPipe->ring[t & RING_MASK];
+  type = slot->type;
+  lineno = slot->lineno;
+  strcpy(tokenString, slot->lexeme);
+  tokenName = slot->name;
+  tokenColumn = slot->column;
+  atomic_store_explicit(&parserPipe->tail, t + 1, memory_order_release);
+  if (type == ENDFILE)
+    parserPipe->ended = TRUE;
+  if (TraceScan)
+  {
+    fprintf(listing, "\t%d: ", lineno);
+    printToken(type, tokenString);
+  }
+  return type;
+}
+
+TreeNode *pipelineParse(FILE *source)
+{
+  pthread_t scanner;
+  TreeNode *tree;
+
+  parserPipe = (Pipe *)malloc(sizeof(Pipe));
+  if (parserPipe == NULL)
+  {
+    fprintf(stderr, "Out of memory in pipelined parse\n");
+    exit(1);
+  }
+  atomic_init(&parserPipe->head, 0);
+  atomic_init(&parserPipe->tail, 0);
+  atomic_init(&parserPipe->stopScanner, FALSE);
+  parserPipe->ended = FALSE;
+  parserPipe->source = source;
+  parserPipe->atoms = atomTable();
+  if (pthread_create(&scanner, NULL, scanSource, parserPipe) != 0)
+  {
+    fprintf(stderr, "Cannot start the scanner thread\n");
+    exit(1);
+  }
+  tree = parseTokens(nextPipedToken);
+  /* after a syntax error the scanner may still be
+   * waiting for room in the ring
+   */
+  atomic_store(&parserPipe->stopScanner, TRUE);
+  pthread_join(scanner, NULL);
+  free(parserPipe);
+  parserPipe = NULL;
+  return tree;
+}
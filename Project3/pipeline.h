@@ -0,0 +1,18 @@
+/****************************************************/
+/* File: pipeline.h                                 */
+/* Pipelined scanning and parsing for the C-MINUS   */
+/* compiler                                         */
+/****************************************************/
+
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+/* Function pipelineParse reads and scans the source
+ * on a thread of its own, which passes the tokens
+ * through a single-producer/single-consumer ring to
+ * the push parser on the calling thread, and returns
+ * the syntax tree
+ */
+TreeNode *pipelineParse(FILE *source);
+
+#endif
@@ -0,0 +1,535 @@
+/****************************************************/
+/* File: rdparse.c                                  */
+/* Recursive-descent parser for C-MINUS             */
+/* Builds the same syntax tree as cminus.y; binary  */
+/* expressions use precedence climbing              */
+/****************************************************/
+
+#include <setjmp.h>
+#include "globals.h"
+#include "util.h"
+#include "scan.h"
+#include "parse.h"
+#include "tokenize.h"
+
+/* The lookahead token is read only when a decision
+ * needs it, at the same points where the yacc parser
+ * reads one. Nodes that take the current lineno
+ * (compound, while and return statements, void
+ * parameter lists) therefore get the same line
+ * numbers as with the yacc parser
+ */
+static _Thread_local TokenType token;        /* current lookahead */
+static _Thread_local int haveToken = FALSE;  /* TRUE if token was read and not consumed */
+static _Thread_local jmp_buf syntaxErrorJump; /* parsing stops at the first error */
+
+/* Every unbounded recursion of the parser goes
+ * through statement() or expression(); nesting counts
+ * their active calls. Past MAXNESTING the parser
+ * stops with the error bison gives when its stack
+ * exceeds YYMAXDEPTH, instead of overflowing the C
+ * stack (a level takes at most about 200 bytes)
+ */
+#define MAXNESTING 10000
+static _Thread_local int nesting = 0;
+
+_Thread_local int lazyBodies = FALSE;
+
+/* function prototypes for recursive calls */
+static TreeNode *declaration(void);
+static TreeNode *var_declaration(void);
+static TreeNode *params(void);
+static TreeNode *compound_stmt(void);
+static TreeNode *statement(void);
+static TreeNode *nestedStatement(void);
+static TreeNode *selection_stmt(void);
+static TreeNode *iteration_stmt(void);
+static TreeNode *return_stmt(void);
+static TreeNode *expression(void);
+static TreeNode *nestedExpression(void);
+static TreeNode *binary(TreeNode *left, int minPrec);
+static TreeNode *factor(void);
+static TreeNode *var_or_call(void);
+static TreeNode *args(void);
+
+static TokenType peek(void)
+{
+  if (!haveToken)
+  {
+    token = getToken();
+    haveToken = TRUE;
+  }
+  return token;
+}
+
+/* same report as yyerror() in cminus.y */
+static void reportError(char *message)
+{
+  fprintf(listing, "Syntax error at line %d: %s\n", lineno, message);
+  fprintf(listing, "Current token: ");
+  printToken(token, tokenString);
+  Error = TRUE;
+  longjmp(syntaxErrorJump, 1);
+}
+
+static void syntaxError(void)
+{
+  reportError("syntax error");
+}
+
+/* enterNesting counts one more level of nesting */
+static void enterNesting(void)
+{
+  if (++nesting > MAXNESTING)
+    reportError("memory exhausted");
+}
+
+static void match(TokenType expected)
+{
+  if (peek() != expected)
+    syntaxError();
+  haveToken = FALSE;
+}
+
+/* appendTo links t after *last in the list *first */
+static void appendTo(TreeNode **first, TreeNode **last, TreeNode *t)
+{
+  if (t == NULL)
+    return;
+  if (*first == NULL)
+    *first = t;
+  else
+    (*last)->sibling = t;
+  *last = t;
+}
+
+static NodeType type_specifier(void)
+{
+  if (peek() == INT)
+  {
+    match(INT);
+    return Int;
+  }
+  match(VOID);
+  return Void;
+}
+
+/* identifier returns the interned name, the line
+ * and the column of an ID token
+ */
+static char *identifier(int *line, int *column)
+{
+  match(ID);
+  *line = lineno;
+  *column = tokenColumn;
+  return tokenName;
+}
+
+static TreeNode *number(void)
+{
+  TreeNode *t;
+  match(NUM);
+  t = newTreeNode(ConstK);
+  t->lineno = lineno;
+  t->val = atoi(tokenString);
+  return t;
+}
+
+static NodeType arrayOf(NodeType type)
+{
+  return type == Int ? IntArray : VoidArray;
+}
+
+/* declaration -> var_declaration | fun_declaration */
+static TreeNode *declaration(void)
+{
+  NodeType type = type_specifier();
+  TreeNode *t;
+  int line, column;
+  char *name = identifier(&line, &column);
+
+  switch (peek())
+  {
+  case SEMI:
+    match(SEMI);
+    t = newTreeNode(VarDeclK);
+    t->type = type;
+    break;
+  case LBRACE:
+    match(LBRACE);
+    t = newTreeNode(VarDeclK);
+    t->type = arrayOf(type);
+    t->child[0] = number();
+    match(RBRACE);
+    match(SEMI);
+    break;
+  case LPAREN:
+    match(LPAREN);
+    t = newTreeNode(FunDeclK);
+    t->type = type;
+    t->child[0] = params();
+    match(RPAREN);
+    if (lazyBodies)
+    {
+      match(LCURLY);
+      t->body = arrayPosition() - 1;
+      skipBlock();
+      match(RCURLY);
+    }
+    else
+      t->child[1] = compound_stmt();
+    break;
+  default:
+    syntaxError();
+    return NULL;
+  }
+  t->lineno = line;
+  t->column = column;
+  t->name = name;
+  return t;
+}
+
+static TreeNode *var_declaration(void)
+{
+  NodeType type = type_specifier();
+  TreeNode *t = newTreeNode(VarDeclK);
+  t->name = identifier(&t->lineno, &t->column);
+  t->type = type;
+  if (peek() == LBRACE)
+  {
+    match(LBRACE);
+    t->type = arrayOf(type);
+    t->child[0] = number();
+    match(RBRACE);
+  }
+  match(SEMI);
+  return t;
+}
+
+static TreeNode *param(NodeType type)
+{
+  TreeNode *t = newTreeNode(ParamK);
+  t->name = identifier(&t->lineno, &t->column);
+  t->type = type;
+  if (peek() == LBRACE)
+  {
+    match(LBRACE);
+    match(RBRACE);
+    t->type = arrayOf(type);
+  }
+  return t;
+}
+
+/* params -> VOID | param_list */
+static TreeNode *params(void)
+{
+  TreeNode *first = NULL, *last = NULL;
+  if (peek() == VOID)
+  {
+    match(VOID);
+    if (peek() == RPAREN)
+    {
+      TreeNode *t = newTreeNode(ParamK);
+      t->lineno = lineno;
+      t->type = Void;
+      return t;
+    }
+    appendTo(&first, &last, param(Void));
+  }
+  else
+    appendTo(&first, &last, param(type_specifier()));
+  while (peek() == COMMA)
+  {
+    match(COMMA);
+    appendTo(&first, &last, param(type_specifier()));
+  }
+  return first;
+}
+
+static TreeNode *compound_stmt(void)
+{
+  TreeNode *decls = NULL, *stmts = NULL, *last = NULL;
+  TreeNode *t;
+  match(LCURLY);
+  while (peek() == INT || peek() == VOID)
+    appendTo(&decls, &last, var_declaration());
+  last = NULL;
+  while (peek() != RCURLY)
+    appendTo(&stmts, &last, statement());
+  match(RCURLY);
+  t = newTreeNode(CompStmtK);
+  t->lineno = lineno;
+  t->child[0] = decls;
+  t->child[1] = stmts;
+  return t;
+}
+
+static TreeNode *statement(void)
+{
+  TreeNode *t;
+  enterNesting();
+  t = nestedStatement();
+  nesting--;
+  return t;
+}
+
+static TreeNode *nestedStatement(void)
+{
+  TreeNode *t;
+  switch (peek())
+  {
+  case LCURLY:
+    return compound_stmt();
+  case IF:
+    return selection_stmt();
+  case WHILE:
+    return iteration_stmt();
+  case RETURN:
+    return return_stmt();
+  case SEMI:
+    match(SEMI);
+    return NULL;
+  default:
+    t = expression();
+    match(SEMI);
+    return t;
+  }
+}
+
+static TreeNode *selection_stmt(void)
+{
+  TreeNode *t = newTreeNode(SelectStmtK);
+  match(IF);
+  match(LPAREN);
+  t->child[0] = expression();
+  match(RPAREN);
+  t->child[1] = statement();
+  if (peek() == ELSE)
+  {
+    match(ELSE);
+    t->flag = TRUE;
+    t->child[2] = statement();
+  }
+  t->lineno = t->child[1] != NULL ? t->child[1]->lineno : lineno;
+  return t;
+}
+
+static TreeNode *iteration_stmt(void)
+{
+  TreeNode *t = newTreeNode(IterStmtK);
+  match(WHILE);
+  match(LPAREN);
+  t->child[0] = expression();
+  match(RPAREN);
+  t->child[1] = statement();
+  t->lineno = lineno;
+  return t;
+}
+
+static TreeNode *return_stmt(void)
+{
+  TreeNode *t = newTreeNode(RetStmtK);
+  match(RETURN);
+  if (peek() == SEMI)
+    t->flag = TRUE;
+  else
+    t->child[0] = expression();
+  match(SEMI);
+  t->lineno = lineno;
+  return t;
+}
+
+static TreeNode *expression(void)
+{
+  TreeNode *t;
+  enterNesting();
+  t = nestedExpression();
+  nesting--;
+  return t;
+}
+
+/* expression -> var = expression | simple_expression */
+static TreeNode *nestedExpression(void)
+{
+  TreeNode *t;
+  if (peek() != ID)
+    return binary(factor(), 1);
+  t = var_or_call();
+  if (t->nodekind == VarExpK && peek() == ASSIGN)
+  {
+    TreeNode *a = newTreeNode(AssignK);
+    match(ASSIGN);
+    a->lineno = t->lineno;
+    a->child[0] = t;
+    a->child[1] = expression();
+    return a;
+  }
+  return binary(t, 1);
+}
+
+/* precedence of binary operators: relational
+ * operators do not associate, the others are left
+ * associative; 0 for tokens that are not operators
+ */
+#define RELATIONAL 1
+
+static int precedence(TokenType op)
+{
+  switch (op)
+  {
+  case EQ:
+  case NE:
+  case LT:
+  case LE:
+  case GT:
+  case GE:
+    return RELATIONAL;
+  case PLUS:
+  case MINUS:
+    return 2;
+  case TIMES:
+  case OVER:
+    return 3;
+  default:
+    return 0;
+  }
+}
+
+/* binary continues the expression whose first
+ * operand is left, taking operators of precedence
+ * minPrec and above (precedence climbing)
+ */
+static TreeNode *binary(TreeNode *left, int minPrec)
+{
+  int prec;
+  while ((prec = precedence(peek())) >= minPrec && prec > 0)
+  {
+    TokenType op = token;
+    TreeNode *t;
+    match(op);
+    t = newTreeNode(OpK);
+    t->op = op;
+    t->lineno = left->lineno;
+    t->child[0] = left;
+    t->child[1] = binary(factor(), prec + 1);
+    left = t;
+    if (prec == RELATIONAL && precedence(peek()) == RELATIONAL)
+      syntaxError();
+  }
+  return left;
+}
+
+static TreeNode *factor(void)
+{
+  TreeNode *t;
+  switch (peek())
+  {
+  case LPAREN:
+    match(LPAREN);
+    t = expression();
+    match(RPAREN);
+    return t;
+  case ID:
+    return var_or_call();
+  case NUM:
+    return number();
+  default:
+    syntaxError();
+    return NULL;
+  }
+}
+
+/* var_or_call -> ID | ID [ expression ] | ID ( args ) */
+static TreeNode *var_or_call(void)
+{
+  int line, column;
+  char *name = identifier(&line, &column);
+  TreeNode *t;
+  if (peek() == LPAREN)
+  {
+    match(LPAREN);
+    t = newTreeNode(CallK);
+    t->child[0] = args();
+    match(RPAREN);
+  }
+  else
+  {
+    t = newTreeNode(VarExpK);
+    if (peek() == LBRACE)
+    {
+      match(LBRACE);
+      t->child[0] = expression();
+      match(RBRACE);
+    }
+  }
+  t->name = name;
+  t->lineno = line;
+  t->column = column;
+  return t;
+}
+
+static TreeNode *args(void)
+{
+  TreeNode *first = NULL, *last = NULL;
+  if (peek() == RPAREN)
+    return NULL;
+  appendTo(&first, &last, expression());
+  while (peek() == COMMA)
+  {
+    match(COMMA);
+    appendTo(&first, &last, expression());
+  }
+  return first;
+}
+
+TreeNode *rdParse(void)
+{
+  TreeNode *first = NULL, *last = NULL;
+  haveToken = FALSE;
+  nesting = 0;
+  if (setjmp(syntaxErrorJump) != 0)
+    return NULL;
+  do
+  {
+    TreeNode *t = declaration();
+    if (declarationProc != NULL)
+      declarationProc(t);
+    else
+      appendTo(&first, &last, t);
+  } while (peek() != ENDFILE);
+  return first;
+}
+
+TreeNode *parseBody(TreeNode *fun)
+{
+  int position = arrayPosition();
+  if (fun->body == 0)
+    return fun->child[1];
+  seekTokenArray(fun->body);
+  haveToken = FALSE;
+  nesting = 0;
+  if (setjmp(syntaxErrorJump) == 0)
+    fun->child[1] = compound_stmt();
+  else
+  {
+    /* an empty body keeps the tree whole */
+    fun->child[1] = newTreeNode(CompStmtK);
+    fun->child[1]->lineno = fun->lineno;
+    fun->body = 0;
+    seekTokenArray(position);
+    haveToken = FALSE;
+    return NULL;
+  }
+  fun->body = 0;
+  seekTokenArray(position);
+  haveToken = FALSE;
+  return fun->child[1];
+}
+
+int parseBodies(TreeNode *list)
+{
+  for (; list != NULL; list = list->sibling)
+    if (list->nodekind == FunDeclK && list->body != 0 && parseBody(list) == NULL)
+      return FALSE;
+  return TRUE;
+}
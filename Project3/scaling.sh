@@ -0,0 +1,44 @@
+#!/bin/sh
+# scaling.sh: the list scaling benchmark of the C-MINUS compiler
+#
+# usage: scaling.sh [compiler option...]
+#
+# Compiles programs with one list (declarations, parameters, local
+# declarations, statements, call arguments) of 125k to 1M elements
+# and prints the time per element. Fails if the time per element of
+# the longest list is more than three times that of the shortest,
+# i.e. if parsing a list is not linear in its length.
+
+COMPILER=${COMPILER:-./cminus_semantic}
+CMGEN=${CMGEN:-./cmgen}
+SIZES=${SIZES:-"125000 250000 500000 1000000"}
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+
+now() { date +%s%N; }
+
+status=0
+printf "%-8s %9s %9s %12s\n" shape elements seconds "ns/element"
+for shape in decls params locals stmts args; do
+  first=""
+  for n in $SIZES; do
+    "$CMGEN" $shape $n > "$dir/$shape.cm" || exit 1
+    start=$(now)
+    "$COMPILER" "$@" "$dir/$shape.cm" > "$dir/out" 2>&1
+    rc=$?
+    ns=$(( $(now) - start ))
+    if [ $rc -ne 0 ]; then
+      echo "$shape $n: compiler exited with status $rc"
+      status=1
+    fi
+    per=$(( ns / n ))
+    printf "%-8s %9d %9s %12d\n" $shape $n $(echo $ns | awk '{printf "%.3f", $1 / 1e9}') $per
+    [ -z "$first" ] && first=$per
+    last=$per
+  done
+  if [ $last -gt $(( first * 3 + 100 )) ]; then
+    echo "$shape: NOT LINEAR ($first -> $last ns/element)"
+    status=1
+  fi
+done
+exit $status
@@ -12,7 +12,17 @@
 #define MAXTOKENLEN 40
 
 /* tokenString array stores the lexeme of each token */
-extern char tokenString[MAXTOKENLEN + 1];
+extern _Thread_local char tokenString[MAXTOKENLEN + 1];
+
+/* tokenName is the interned (see atom.h) lexeme
+ * of the last ID token
+ */
+extern _Thread_local char *tokenName;
+
+/* tokenColumn is the column (from 1) of the last
+ * ID token
+ */
+extern _Thread_local int tokenColumn;
 
 /* function getToken returns the
  * next token in source file
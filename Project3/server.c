@@ -0,0 +1,345 @@
+/****************************************************/
+/* File: server.c                                   */
+/* Compile server for the C-MINUS compiler: the     */
+/* socket, its threads and the wire format of       */
+/* requests and replies                             */
+/****************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server.h"
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+/* On the wire, in the byte order of the machine
+ * (the socket is local), every number is a uint32_t
+ * and every string its length and then its bytes.
+ * A request is argc, dir, argv[0..argc) and the text
+ * (NO_TEXT alone if there is none); the client then
+ * shuts down its side. The reply is the exit status,
+ * the listing and the messages
+ */
+#define NO_TEXT 0xffffffffu
+
+/* limits a request is checked against */
+#define MAX_ARGS 65536
+#define MAX_STRING (1 << 20)
+#define MAX_TEXT (1 << 30)
+
+static int readAll(int fd, void *buf, size_t size)
+{
+  char *p = (char *)buf;
+  while (size > 0)
+  {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return FALSE;
+    p += n;
+    size -= n;
+  }
+  return TRUE;
+}
+
+static int writeAll(int fd, const void *buf, size_t size)
+{
+  const char *p = (const char *)buf;
+  while (size > 0)
+  {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return FALSE;
+    p += n;
+    size -= n;
+  }
+  return TRUE;
+}
+
+static int writeNumber(int fd, uint32_t n)
+{
+  return writeAll(fd, &n, sizeof(n));
+}
+
+static int writeString(int fd, const char *s, size_t length)
+{
+  return writeNumber(fd, (uint32_t)length) && writeAll(fd, s, length);
+}
+
+/* readString reads a string of at most limit bytes
+ * into a NUL-terminated malloc'ed buffer; NULL if
+ * the connection fails or it is longer
+ */
+static char *readString(int fd, uint32_t limit, int *length)
+{
+  uint32_t n;
+  char *s;
+  if (!readAll(fd, &n, sizeof(n)) || n > limit)
+    return NULL;
+  s = (char *)malloc(n + 1);
+  if (s == NULL)
+    return NULL;
+  if (!readAll(fd, s, n))
+  {
+    free(s);
+    return NULL;
+  }
+  s[n] = '\0';
+  if (length != NULL)
+    *length = (int)n;
+  return s;
+}
+
+static void freeRequest(ServerRequest *r)
+{
+  int i;
+  free(r->dir);
+  for (i = 0; i < r->argc; i++)
+    free(r->argv[i]);
+  free(r->argv);
+  free(r->text);
+}
+
+/* readRequest reads a request; FALSE if the client
+ * sent something else
+ */
+static int readRequest(int fd, ServerRequest *r)
+{
+  uint32_t argc, textLength;
+  memset(r, 0, sizeof(*r));
+  if (!readAll(fd, &argc, sizeof(argc)) || argc < 1 || argc > MAX_ARGS)
+    return FALSE;
+  r->argv = (char **)calloc(argc + 1, sizeof(char *));
+  r->dir = readString(fd, MAX_STRING, NULL);
+  if (r->argv == NULL || r->dir == NULL)
+    return FALSE;
+  for (; r->argc < (int)argc; r->argc++)
+    if ((r->argv[r->argc] = readString(fd, MAX_STRING, NULL)) == NULL)
+      return FALSE;
+  if (!readAll(fd, &textLength, sizeof(textLength)))
+    return FALSE;
+  if (textLength == NO_TEXT)
+    return TRUE;
+  if (textLength > MAX_TEXT || (r->text = (char *)malloc(textLength + 1)) == NULL ||
+      !readAll(fd, r->text, textLength))
+    return FALSE;
+  r->text[textLength] = '\0';
+  r->textLength = (int)textLength;
+  return TRUE;
+}
+
+typedef struct
+{
+  int listener;
+  ServerHandler handler;
+} Server;
+
+/* serveConnection runs the request of a client and
+ * sends the reply
+ */
+static void serveConnection(Server *server, int fd)
+{
+  ServerRequest request;
+  char *outText = NULL, *errText = NULL;
+  size_t outSize = 0, errSize = 0;
+  FILE *out, *err;
+  int status;
+
+  if (!readRequest(fd, &request))
+  {
+    freeRequest(&request);
+    return;
+  }
+  out = open_memstream(&outText, &outSize);
+  err = open_memstream(&errText, &errSize);
+  if (out == NULL || err == NULL)
+  {
+    fprintf(stderr, "Out of memory in compile server\n");
+    exit(1);
+  }
+  status = server->handler(&request, out, err);
+  fclose(out);
+  fclose(err);
+  if (writeNumber(fd, (uint32_t)status) && writeString(fd, outText, outSize))
+    writeString(fd, errText, errSize);
+  free(outText);
+  free(errText);
+  freeRequest(&request);
+}
+
+static void *serverThread(void *arg)
+{
+  Server *server = (Server *)arg;
+  for (;;)
+  {
+    int fd = accept(server->listener, NULL, NULL);
+    if (fd < 0)
+    {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      fprintf(stderr, "Compile server cannot accept: %s\n", strerror(errno));
+      exit(1);
+    }
+    serveConnection(server, fd);
+    close(fd);
+  }
+  return NULL;
+}
+
+/* privateDirectory tells whether dir is a directory
+ * of the user's that no one else can write to
+ */
+static int privateDirectory(const char *dir)
+{
+  struct stat st;
+  return lstat(dir, &st) == 0 && S_ISDIR(st.st_mode) && st.st_uid == getuid() &&
+         (st.st_mode & 022) == 0;
+}
+
+const char *serverPath(void)
+{
+  static char path[4096]; /* too long for a socket is refused later */
+  const char *dir = getenv("CMINUS_SERVER");
+  if (dir != NULL && dir[0] != '\0')
+    return dir;
+  dir = getenv("XDG_RUNTIME_DIR");
+  if (dir != NULL && dir[0] == '/' && privateDirectory(dir))
+    snprintf(path, sizeof(path), "%s/%s", dir, SERVER_SOCKET);
+  else
+  {
+    /* a directory of the same name made by someone
+     * else is refused below
+     */
+    snprintf(path, sizeof(path), "/tmp/cminus-%d", (int)getuid());
+    if (mkdir(path, 0700) != 0 && errno != EEXIST)
+      return NULL;
+    if (!privateDirectory(path))
+      return NULL;
+    strcat(path, "/" SERVER_SOCKET);
+  }
+  return path;
+}
+
+/* socketAddress fills addr with path; FALSE if the
+ * path is too long for a socket
+ */
+static int socketAddress(struct sockaddr_un *addr, const char *path)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr->sun_path))
+    return FALSE;
+  strcpy(addr->sun_path, path);
+  return TRUE;
+}
+
+int serve(const char *path, int threads, ServerHandler handler)
+{
+  static Server server;
+  struct sockaddr_un addr;
+  struct stat st;
+  int i;
+
+  if (!socketAddress(&addr, path))
+    return FALSE;
+  server.handler = handler;
+  server.listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server.listener < 0)
+    return FALSE;
+  /* only a socket no one answers on is removed */
+  if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+  {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    int live = fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    if (fd >= 0)
+      close(fd);
+    if (live)
+    {
+      fprintf(stderr, "A compile server is already listening on %s\n", path);
+      close(server.listener);
+      return FALSE;
+    }
+    unlink(path);
+  }
+  if (bind(server.listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(server.listener, 128) != 0)
+  {
+    close(server.listener);
+    return FALSE;
+  }
+  /* a client that goes away costs only its reply */
+  signal(SIGPIPE, SIG_IGN);
+  if (threads < 1)
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  for (i = 1; i < threads; i++)
+  {
+    pthread_t id;
+    if (pthread_create(&id, NULL, serverThread, &server) != 0)
+    {
+      fprintf(stderr, "Cannot start a compile server thread\n");
+      exit(1);
+    }
+    pthread_detach(id);
+  }
+  serverThread(&server);
+  return TRUE;
+}
+
+int requestCompile(const char *path, ServerRequest *request, FILE *out, FILE *err)
+{
+  struct sockaddr_un addr;
+  uint32_t status;
+  char *outText, *errText;
+  int outLength, errLength;
+  int fd, i, sent;
+
+  if (!socketAddress(&addr, path))
+    return -1;
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+  {
+    close(fd);
+    return -1;
+  }
+  signal(SIGPIPE, SIG_IGN);
+  sent = writeNumber(fd, (uint32_t)request->argc) &&
+         writeString(fd, request->dir, strlen(request->dir));
+  for (i = 0; sent && i < request->argc; i++)
+    sent = writeString(fd, request->argv[i], strlen(request->argv[i]));
+  if (sent)
+    sent = request->text == NULL ? writeNumber(fd, NO_TEXT)
+                                 : writeString(fd, request->text, request->textLength);
+  shutdown(fd, SHUT_WR);
+  if (!sent || !readAll(fd, &status, sizeof(status)) ||
+      (outText = readString(fd, NO_TEXT - 1, &outLength)) == NULL)
+  {
+    close(fd);
+    return -1;
+  }
+  errText = readString(fd, NO_TEXT - 1, &errLength);
+  close(fd);
+  fwrite(outText, 1, outLength, out);
+  if (errText != NULL)
+    fwrite(errText, 1, errLength, err);
+  free(outText);
+  free(errText);
+  return (int)status;
+}
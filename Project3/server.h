@@ -0,0 +1,66 @@
+/****************************************************/
+/* File: server.h                                   */
+/* Compile server interface for the C-MINUS         */
+/* compiler: command lines sent over a Unix-domain  */
+/* socket to a compiler that stays running          */
+/****************************************************/
+
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include <stdio.h>
+
+/* the name of the socket used when CMINUS_SERVER is
+ * not set, in $XDG_RUNTIME_DIR or else in a directory
+ * of the user's own under /tmp
+ */
+#define SERVER_SOCKET "cminus.sock"
+
+/* A ServerRequest is a command line of the compiler:
+ * its arguments, argv[0] included, the directory
+ * its relative paths are in, and the text of the
+ * client's standard input for a "-" source file
+ */
+typedef struct
+{
+  char *dir;
+  int argc;
+  char **argv;
+  char *text; /* NULL if not sent */
+  int textLength;
+} ServerRequest;
+
+/* A ServerHandler runs a request, printing the
+ * listing to out and the messages of the compiler
+ * to err, and returns the exit status
+ */
+typedef int (*ServerHandler)(ServerRequest *request, FILE *out, FILE *err);
+
+/* Function serverPath returns the path of the
+ * server's socket: $CMINUS_SERVER or SERVER_SOCKET
+ * in a directory only the user can write to, which
+ * it creates under /tmp if need be. Returns NULL if
+ * there is no such directory
+ */
+const char *serverPath(void);
+
+/* Function serve listens on the socket at path and
+ * runs the requests with handler on threads threads.
+ * Each thread takes one connection at a time, so
+ * what it keeps warm from a compilation serves the
+ * next one. A socket left at path by a server that
+ * is gone is replaced. Returns FALSE if the socket
+ * cannot be set up or a server is listening on it,
+ * and does not return otherwise
+ */
+int serve(const char *path, int threads, ServerHandler handler);
+
+/* Function requestCompile sends request to the
+ * server at path and copies the listing to out and
+ * the messages to err. Returns the exit status of
+ * the request, or -1 if the server cannot be
+ * reached
+ */
+int requestCompile(const char *path, ServerRequest *request, FILE *out, FILE *err);
+
+#endif
@@ -0,0 +1,91 @@
+#!/bin/sh
+# stress.sh: the stress tests of the C-MINUS compiler
+#
+# usage: stress.sh
+#
+# Compiles a body of a million statements and each construct nested
+# 100k deep with every parser and analysis option, and fails if a
+# run crashes, takes longer than STRESS_TIMEOUT seconds or prints
+# anything but what the default compilation prints. The recursive-
+# descent parser (-r, -l) may instead stop at its nesting limit with
+# "memory exhausted".
+#
+# Then compiles up to 100k functions and 10k nested blocks, and fails
+# if the symbol table reports anything but the undeclared names cmgen
+# plants in them, or if the time per function or block of the largest
+# program is more than three times that of the smallest.
+
+COMPILER=${COMPILER:-./cminus_semantic}
+CMGEN=${CMGEN:-./cmgen}
+STATEMENTS=${STATEMENTS:-1000000}
+DEPTH=${DEPTH:-100000}
+FUNCTIONS=${FUNCTIONS:-100000}
+SCOPES=${SCOPES:-10000}
+STRESS_TIMEOUT=${STRESS_TIMEOUT:-60}
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+
+now() { date +%s%N; }
+
+# compile runs the compiler with the given options on $dir/$1.cm and
+# sets result to how its output compares with $dir/expected
+compile()
+{
+  file=$dir/$1.cm
+  shift
+  start=$(now)
+  timeout $STRESS_TIMEOUT "$COMPILER" "$@" "$file" > "$dir/out" 2>&1
+  rc=$?
+  ns=$(( $(now) - start ))
+  sed 1,2d "$dir/out" > "$dir/actual"
+  if [ $rc -ge 124 ]; then
+    result="FAILED (status $rc)"
+    status=1
+  elif cmp -s "$dir/expected" "$dir/actual"; then
+    result=ok
+  elif grep -q "memory exhausted" "$dir/actual" &&
+       { [ "$*" = -r ] || [ "$*" = -l ]; }; then
+    result="ok (nesting limit)"
+  else
+    result="FAILED (output differs)"
+    status=1
+  fi
+}
+
+status=0
+for test in "stmts $STATEMENTS" "ifs $DEPTH" "whiles $DEPTH" "blocks $DEPTH" \
+            "parens $DEPTH" "sums $DEPTH" "assigns $DEPTH" "indexes $DEPTH" \
+            "calls $DEPTH"; do
+  set -- $test
+  "$CMGEN" $1 $2 > "$dir/$1.cm" || exit 1
+  timeout $STRESS_TIMEOUT "$COMPILER" "$dir/$1.cm" 2>&1 | sed 1,2d > "$dir/expected"
+  for options in "" -r -t -p -l -s -a -h -g "-j 2" "-s -t" "-f 1"; do
+    compile $1 $options
+    printf "%-8s %8d %-6s %s\n" $1 $2 "$options" "$result"
+  done
+done
+
+for test in "funcs $FUNCTIONS" "scopes $SCOPES"; do
+  set -- $test
+  first=""
+  for n in $(( $2 / 8 )) $(( $2 / 4 )) $(( $2 / 2 )) $2; do
+    "$CMGEN" $1 $n > "$dir/$1.cm" || exit 1
+    # the planted names are the only one-letter statements
+    grep -n '^ *[a-z];$' "$dir/$1.cm" |
+      sed 's/^\([0-9]*\): *\([a-z]\);$/Error: undeclared variable "\2" is used at line \1/' \
+      > "$dir/expected"
+    for options in "" -r -s "-j 2"; do
+      compile $1 $options
+      printf "%-8s %8d %-6s %-18s %9d ns/element\n" $1 $n "$options" "$result" $(( ns / n ))
+      if [ -z "$options" ]; then
+        [ -z "$first" ] && first=$(( ns / n ))
+        last=$(( ns / n ))
+      fi
+    done
+  done
+  if [ $last -gt $(( first * 3 + 100 )) ]; then
+    echo "$1: NOT LINEAR ($first -> $last ns/element)"
+    status=1
+  fi
+done
+exit $status
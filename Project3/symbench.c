@@ -0,0 +1,279 @@
+/****************************************************/
+/* File: symbench.c                                 */
+/* Symbol table benchmark for the C-MINUS compiler: */
+/* synthetic workloads drive st_insert, st_lookup   */
+/* and the scope stack with both lookup engines     */
+/* and report ns/op, probe lengths and memory       */
+/****************************************************/
+
+#include <time.h>
+#include "globals.h"
+#include "symtab.h"
+#include "atom.h"
+#include "arena.h"
+
+/* times each measurement is repeated; the best is kept */
+#define REPEAT 3
+
+/* empty blocks pushed and popped per measurement */
+#define BLOCKS 100000
+
+/* A Workload declares the first half of its names,
+ * spread evenly over depth + 1 nested scopes, and
+ * the last shadowing names in every scope; the
+ * names in between are looked up and not found
+ */
+typedef struct
+{
+  const char *name;
+  int count;     /* names */
+  char **names;  /* interned */
+  int depth;     /* scopes below the global one */
+  int shadowing; /* names redeclared in every scope */
+  int lookups;   /* lookups per measurement */
+} Workload;
+
+static TreeNode declNode; /* what every entry points to */
+
+static double now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* makeNames returns count distinct names, short or
+ * long, in malloc'ed memory
+ */
+static char **makeNames(int count, int longNames, int seed)
+{
+  char **names = (char **)malloc(count * sizeof(char *));
+  int i;
+  for (i = 0; i < count; i++)
+  {
+    char buf[64];
+    int n = i, len = 0;
+    if (longNames)
+      len = sprintf(buf, "generatedIdentifier%c", 'A' + seed);
+    else
+      buf[len++] = 'a' + seed;
+    do
+    {
+      buf[len++] = 'a' + n % 26;
+      n /= 26;
+    } while (n > 0);
+    buf[len] = '\0';
+    names[i] = strdup(buf);
+  }
+  return names;
+}
+
+static void report(const Workload *w, const char *op, int n, double seconds, double probes)
+{
+  printf("%-8s %-8s %-13s %8d %10.1f", w->name, shadowStacks ? "shadow" : "chained",
+         op, n, seconds * 1e9 / n);
+  if (probes >= 0)
+    printf(" %8.2f", probes);
+  printf("\n");
+}
+
+/* chainProbes counts the slots a chained lookup of
+ * name looks at, through all scopes from the top
+ */
+static int chainProbes(char *name)
+{
+  ScopeList scope = get_top_scope();
+  int probes = 0;
+  for (; scope != NULL; scope = scope->parent)
+  {
+    unsigned int mask = scope->slotCount - 1;
+    unsigned int i = atomOf(name)->hash & mask;
+    for (;;)
+    {
+      probes++;
+      if (scope->slots[i] == NULL)
+        break;
+      if (scope->slots[i]->name == name)
+        return probes;
+      i = (i + 1) & mask;
+    }
+  }
+  return probes;
+}
+
+/* averageProbes returns the mean probe length of
+ * looking up the names [first, first+count)
+ */
+static double averageProbes(char **names, int first, int count)
+{
+  long probes = 0;
+  int i;
+  if (shadowStacks)
+    return 1.0;
+  for (i = first; i < first + count; i++)
+    probes += chainProbes(names[i]);
+  return (double)probes / count;
+}
+
+/* build declares the workload: the global scope, the
+ * nested scopes, the first half of the names spread
+ * over them and the shadowed names in every scope.
+ * Returns the time per insert
+ */
+static double build(const Workload *w)
+{
+  int declared = w->count / 2, i, d, k = 0;
+  double start = now();
+  push_scope(create_scope("global"));
+  for (d = 0; d <= w->depth; d++)
+  {
+    int stop = (long)declared * (d + 1) / (w->depth + 1);
+    if (d > 0)
+      push_scope(create_scope("block"));
+    for (; k < stop; k++)
+      st_insert(w->names[k], 0, addLocation(), &declNode);
+    for (i = 0; i < w->shadowing; i++)
+      st_insert(w->names[w->count - 1 - i], 0, addLocation(), &declNode);
+  }
+  return (now() - start) / (declared + (w->depth + 1) * w->shadowing);
+}
+
+static void teardown(const Workload *w)
+{
+  int d;
+  for (d = 0; d <= w->depth; d++)
+    pop_scope();
+  release_scopes(0);
+  arenaFree(&symtabArena);
+}
+
+/* lookups times n lookups cycling through the
+ * names [first, first+count)
+ */
+static double lookups(int n, char **names, int first, int count)
+{
+  double start = now();
+  int i, j = 0;
+  long found = 0;
+  for (i = 0; i < n; i++)
+  {
+    found += st_lookup_return_bucket(names[first + j]) != NULL;
+    if (++j == count)
+      j = 0;
+  }
+  if (found < 0)
+    printf("unreachable\n");
+  return now() - start;
+}
+
+static void run(const Workload *w)
+{
+  int declared = w->count / 2;
+  int missed = w->count - declared - w->shadowing;
+  int inserts = declared + (w->depth + 1) * w->shadowing;
+  double best[5] = {1e9, 1e9, 1e9, 1e9, 1e9};
+  double probes[3] = {0, 0, 0};
+  size_t bytes = 0;
+  int r;
+
+  for (r = 0; r < REPEAT; r++)
+  {
+    double t[5], start;
+    int i;
+
+    bytes = symtabArena.bytes;
+    t[0] = build(w) * inserts;
+    bytes = symtabArena.bytes - bytes;
+    probes[0] = averageProbes(w->names, 0, declared);
+    t[1] = lookups(w->lookups, w->names, 0, declared);
+    probes[1] = averageProbes(w->names, declared, missed);
+    t[2] = lookups(w->lookups, w->names, declared, missed);
+    if (w->shadowing > 0)
+    {
+      probes[2] = averageProbes(w->names, w->count - w->shadowing, w->shadowing);
+      t[3] = lookups(w->lookups, w->names, w->count - w->shadowing, w->shadowing);
+    }
+    /* blocks that declare nothing, as most do */
+    start = now();
+    for (i = 0; i < BLOCKS; i++)
+    {
+      push_scope(create_scope("block"));
+      pop_scope();
+      release_scopes(scope_count() - 1);
+    }
+    t[4] = now() - start;
+    for (i = 0; i < 5; i++)
+      if (t[i] < best[i])
+        best[i] = t[i];
+    teardown(w);
+  }
+  report(w, "insert", inserts, best[0], -1);
+  report(w, "lookup-hit", w->lookups, best[1], probes[0]);
+  report(w, "lookup-miss", w->lookups, best[2], probes[1]);
+  if (w->shadowing > 0)
+    report(w, "lookup-shadow", w->lookups, best[3], probes[2]);
+  report(w, "push-pop", BLOCKS, best[4], -1);
+  printf("%-8s %-8s %-13s %8d %10.1f bytes/entry\n", w->name,
+         shadowStacks ? "shadow" : "chained", "memory", inserts, (double)bytes / inserts);
+}
+
+/* makeWorkload interns the names of a workload and
+ * returns the time per intern
+ */
+static double makeWorkload(Workload *w, const char *name, int count, int longNames,
+                           int depth, int shadowing, int lookups, int seed)
+{
+  double start;
+  int i;
+  w->name = name;
+  w->count = count;
+  w->depth = depth;
+  w->shadowing = shadowing;
+  w->lookups = lookups;
+  w->names = makeNames(count, longNames, seed);
+  start = now();
+  for (i = 0; i < count; i++)
+  {
+    char *copy = w->names[i];
+    w->names[i] = intern(copy);
+    free(copy);
+  }
+  return (now() - start) / count;
+}
+
+int main(int argc, char *argv[])
+{
+  Workload workloads[4];
+  double internTime[4];
+  int scale = argc > 1 ? atoi(argv[1]) : 100000;
+  int i, engine;
+
+  if (scale <= 0)
+  {
+    fprintf(stderr, "usage: %s [names]\n", argv[0]);
+    exit(1);
+  }
+  /* many short names in one scope */
+  internTime[0] = makeWorkload(&workloads[0], "short", scale, FALSE, 0, 0, 1000000, 0);
+  /* long names with a common prefix */
+  internTime[1] = makeWorkload(&workloads[1], "long", scale, TRUE, 0, 0, 1000000, 1);
+  /* one name per scope, 10000 scopes deep */
+  internTime[2] = makeWorkload(&workloads[2], "deep", 20000, FALSE, 9999, 0, 20000, 2);
+  /* 8 names redeclared in each of 1000 nested scopes */
+  internTime[3] = makeWorkload(&workloads[3], "shadow", 1016, FALSE, 999, 8, 100000, 3);
+
+  printf("hash %s, %d names\n", atomHashName(), scale);
+  printf("%-8s %-8s %-13s %8s %10s %8s\n", "workload", "engine", "operation", "n", "ns/op", "probes");
+  for (i = 0; i < 4; i++)
+    printf("%-8s %-8s %-13s %8d %10.1f\n", workloads[i].name, "atoms", "intern",
+           workloads[i].count, internTime[i] * 1e9);
+  for (engine = 0; engine < 2; engine++)
+  {
+    shadowStacks = engine;
+    for (i = 0; i < 4; i++)
+      run(&workloads[i]);
+  }
+  printf("atoms: %d names, %lu bytes, %.2f probes per lookup\n", atomCount(),
+         (unsigned long)atomArena.bytes, atomProbeLength());
+  return 0;
+}
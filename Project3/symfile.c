@@ -0,0 +1,65 @@
+/****************************************************/
+/* File: symfile.c                                  */
+/* Symbol table file format for the C-MINUS         */
+/* compiler and its query tool                      */
+/****************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "symfile.h"
+
+unsigned int symFileHash(const char *s)
+{
+  unsigned int h = 2166136261u;
+  while (*s != '\0')
+    h = (h ^ (unsigned char)*s++) * 16777619u;
+  return h;
+}
+
+/* sectionFits tells whether count records of the
+ * given size at offset lie within size bytes
+ */
+static int sectionFits(unsigned int offset, unsigned int count,
+                       unsigned int recordSize, unsigned int size)
+{
+  return offset <= size && count <= (size - offset) / recordSize;
+}
+
+const SymFileHeader *mapSymtabFile(const char *path)
+{
+  const SymFileHeader *h;
+  struct stat st;
+  void *p;
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0)
+    return NULL;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SymFileHeader))
+  {
+    close(fd);
+    return NULL;
+  }
+  p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    return NULL;
+  h = (const SymFileHeader *)p;
+  if (memcmp(h->magic, SYMFILE_MAGIC, sizeof(h->magic)) != 0 ||
+      h->version != SYMFILE_VERSION || h->fileSize != (unsigned int)st.st_size ||
+      !sectionFits(h->scopeOffset, h->scopeCount, sizeof(SymFileScope), h->fileSize) ||
+      !sectionFits(h->symbolOffset, h->symbolCount, sizeof(SymFileSymbol), h->fileSize) ||
+      !sectionFits(h->refOffset, h->refCount, sizeof(SymFileRef), h->fileSize) ||
+      !sectionFits(h->indexOffset, h->indexSize, sizeof(unsigned int), h->fileSize) ||
+      !sectionFits(h->stringOffset, h->stringSize, 1, h->fileSize) ||
+      h->indexSize == 0 || (h->indexSize & (h->indexSize - 1)) != 0 ||
+      h->stringSize == 0 || ((const char *)p)[h->stringOffset + h->stringSize - 1] != '\0')
+  {
+    munmap(p, st.st_size);
+    return NULL;
+  }
+  return h;
+}
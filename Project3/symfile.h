@@ -0,0 +1,92 @@
+/****************************************************/
+/* File: symfile.h                                  */
+/* Symbol table file format for the C-MINUS         */
+/* compiler and its query tool                      */
+/****************************************************/
+
+#ifndef _SYMFILE_H_
+#define _SYMFILE_H_
+
+/* A symbol table file is meant to be mapped into
+ * memory and read in place. It is a header followed
+ * by five sections at the offsets the header gives,
+ * each 4-byte aligned:
+ *   scopes   SymFileScope[scopeCount]
+ *   symbols  SymFileSymbol[symbolCount], by scope
+ *   refs     SymFileRef[refCount]: each symbol's
+ *            listed lines, then its uses
+ *   index    unsigned int[indexSize]: open addressing
+ *            on symFileHash(name), linear probing;
+ *            symbol number + 1, 0 for an empty slot
+ *   strings  NUL-terminated names
+ * All numbers are in the byte order of the writer.
+ * writeSymtabFile (symtab.h) writes one
+ */
+
+#define SYMFILE_MAGIC "C-MINUS SYMTAB\n"
+#define SYMFILE_VERSION 1
+
+/* symbol kinds */
+#define SYM_VARIABLE 0
+#define SYM_FUNCTION 1
+#define SYM_PARAMETER 2
+
+/* symbol types */
+#define SYM_INT 0
+#define SYM_VOID 1
+#define SYM_INT_ARRAY 2
+#define SYM_VOID_ARRAY 3
+#define SYM_UNDETERMINED 4
+
+typedef struct
+{
+  char magic[16];
+  unsigned int version;
+  unsigned int fileSize;
+  unsigned int scopeCount, scopeOffset;
+  unsigned int symbolCount, symbolOffset;
+  unsigned int refCount, refOffset;
+  unsigned int indexSize, indexOffset; /* indexSize is a power of two */
+  unsigned int stringSize, stringOffset;
+} SymFileHeader;
+
+typedef struct
+{
+  unsigned int name;   /* string offset */
+  int parent;          /* scope number, -1 for none */
+  unsigned int depth;
+  unsigned int firstSymbol;
+  unsigned int symbolCount;
+} SymFileScope;
+
+typedef struct
+{
+  unsigned int name; /* string offset */
+  unsigned int scope;
+  unsigned int kind; /* SYM_* */
+  unsigned int type; /* SYM_INT ... */
+  int memloc;
+  unsigned int line, column; /* definition */
+  unsigned int firstRef;
+  unsigned int lineCount; /* listed lines after the first */
+  unsigned int useCount;
+} SymFileSymbol;
+
+typedef struct
+{
+  unsigned int line, column;
+} SymFileRef;
+
+/* Function symFileHash is the hash of the index,
+ * 32-bit FNV-1a of the name
+ */
+unsigned int symFileHash(const char *s);
+
+/* Function mapSymtabFile maps the file at path into
+ * memory read-only and checks its header and section
+ * bounds; returns NULL if it cannot or the file is
+ * not a valid symbol table file
+ */
+const SymFileHeader *mapSymtabFile(const char *path);
+
+#endif
@@ -2,8 +2,7 @@
 /* File: symtab.c                                   */
 /* Symbol table implementation for the TINY compiler*/
 /* (allows only one symbol table)                   */
-/* Symbol table is implemented as a chained         */
-/* hash table                                       */
+/* Each scope is an open addressing hash table      */
 /* Compiler Construction: Principles and Practice   */
 /* Kenneth C. Louden                                */
 /****************************************************/
@@ -12,33 +11,56 @@
 #include <stdlib.h>
 #include <string.h>
 #include "symtab.h"
+#include <unistd.h>
+#include <sys/stat.h>
+#include "atom.h"
+#include "arena.h"
+#include "symfile.h"
+
+/* the hash function: names are interned, so the
+ * hash was computed once by the atom table
+ */
+#define hash(name) (atomOf(name)->hash)
 
-/* SHIFT is the power of two used as multiplier
-   in hash function  */
-#define SHIFT 4
+/* all scopes in order of creation, the active
+ * chain, and the next memory location of each
+ * active scope; the arrays grow by doubling. Each
+ * thread has its own
+ */
+_Thread_local ScopeList *scopeList = NULL;
+_Thread_local int sizeOfScopeList = 0;
+static _Thread_local int scopeListCapacity = 0;
+_Thread_local ScopeList *scopeStack = NULL;
+_Thread_local int sizeOfScopeStack = 0;
+_Thread_local int *location = NULL;
+static _Thread_local int scopeStackCapacity = 0;
+_Thread_local Arena *scopeArena = NULL;
+_Thread_local int shadowStacks = FALSE;
+_Thread_local int xrefIndex = FALSE;
+
+/* the scope of which lookups see only the entries
+ * below limitLocation (see limit_scope)
+ */
+static _Thread_local ScopeList limitedScope = NULL;
+static _Thread_local int limitLocation;
 
-/* the hash function */
-static int hash(char *key)
+/* growArray returns array, made room for one more
+ * than count elements of the given size
+ */
+static void *growArray(void *array, int count, int *capacity, size_t size)
 {
-  int temp = 0;
-  int i = 0;
-  while (key[i] != '\0')
+  if (count < *capacity)
+    return array;
+  *capacity = *capacity ? 2 * *capacity : 64;
+  array = realloc(array, *capacity * size);
+  if (array == NULL)
   {
-    temp = ((temp << SHIFT) + key[i]) % SIZE;
-    ++i;
+    fprintf(stderr, "Out of memory in symbol table\n");
+    exit(1);
   }
-  return temp;
+  return array;
 }
 
-/* the hash table */
-// static BucketList hashTable[SIZE];
-
-ScopeList scopeList[SIZE];
-int sizeOfScopeList = 0;
-ScopeList scopeStack[SIZE];
-int sizeOfScopeStack = 0;
-int location[SIZE];
-
 int addLocation()
 {
   return location[sizeOfScopeStack - 1]++;
@@ -46,25 +68,112 @@ int addLocation()
 
 ScopeList create_scope(char *name)
 {
-  ScopeList scope = (ScopeList)malloc(sizeof(struct ScopeListRec));
+  Arena *arena = scopeArena != NULL ? scopeArena : &symtabArena;
+  ScopeList scope = (ScopeList)arenaAlloc(arena, sizeof(struct ScopeListRec));
   scope->name = name;
-  for (int i = 0; i < SIZE; i++)
-  {
-    scope->hashTable[i] = NULL;
-  }
+  scope->slots = scope->inlineSlots;
+  scope->slotCount = SCOPE_INLINE_SLOTS;
+  scope->arena = arena;
+  scope->number = sizeOfScopeList;
+  scopeList = (ScopeList *)growArray(scopeList, sizeOfScopeList,
+                                     &scopeListCapacity, sizeof(ScopeList));
   scopeList[sizeOfScopeList++] = scope;
-  scope->parent = scopeStack[sizeOfScopeStack - 1];
+  scope->parent = sizeOfScopeStack > 0 ? scopeStack[sizeOfScopeStack - 1] : NULL;
+  scope->depth = sizeOfScopeStack;
   return scope;
 }
 
+int scope_count()
+{
+  return sizeOfScopeList;
+}
+
+void release_scopes(int count)
+{
+  sizeOfScopeList = count;
+}
+
+void free_scopes()
+{
+  free(scopeList);
+  free(scopeStack);
+  free(location);
+  scopeList = scopeStack = NULL;
+  location = NULL;
+  sizeOfScopeList = sizeOfScopeStack = 0;
+  scopeListCapacity = scopeStackCapacity = 0;
+}
+
+ScopeList get_scope(int i)
+{
+  return scopeList[i];
+}
+
+ScopeList *take_scopes(int *count)
+{
+  ScopeList *scopes = scopeList;
+  *count = sizeOfScopeList;
+  scopeList = NULL;
+  sizeOfScopeList = scopeListCapacity = 0;
+  free(scopeStack);
+  free(location);
+  scopeStack = NULL;
+  location = NULL;
+  sizeOfScopeStack = scopeStackCapacity = 0;
+  limitedScope = NULL;
+  return scopes;
+}
+
+void append_scopes(ScopeList *scopes, int count)
+{
+  int i;
+  for (i = 0; i < count; i++)
+  {
+    scopeList = (ScopeList *)growArray(scopeList, sizeOfScopeList,
+                                       &scopeListCapacity, sizeof(ScopeList));
+    scopes[i]->number = sizeOfScopeList;
+    scopeList[sizeOfScopeList++] = scopes[i];
+  }
+}
+
+void limit_scope(ScopeList scope, int locations)
+{
+  limitedScope = scope;
+  limitLocation = locations;
+}
+
+/* showEntry pushes l on its name's stack */
+static void showEntry(BucketList l)
+{
+  Atom atom = atomOf(l->name);
+  l->shadowed = atom->visible;
+  atom->visible = l;
+}
+
 void push_scope(ScopeList scope)
 {
+  int capacity = scopeStackCapacity; /* location grows along */
+  scopeStack = (ScopeList *)growArray(scopeStack, sizeOfScopeStack,
+                                      &scopeStackCapacity, sizeof(ScopeList));
+  location = (int *)growArray(location, sizeOfScopeStack, &capacity, sizeof(int));
   location[sizeOfScopeStack] = 0;
   scopeStack[sizeOfScopeStack++] = scope;
+  if (shadowStacks)
+  {
+    BucketList l;
+    for (l = scope->entries; l != NULL; l = l->next)
+      showEntry(l);
+  }
 }
 
 void pop_scope()
 {
+  if (shadowStacks)
+  {
+    BucketList l;
+    for (l = get_top_scope()->entries; l != NULL; l = l->next)
+      atomOf(l->name)->visible = l->shadowed;
+  }
   sizeOfScopeStack--;
 }
 
@@ -73,6 +182,81 @@ ScopeList get_top_scope()
   return scopeStack[sizeOfScopeStack - 1];
 }
 
+/* slotOf returns the slot of name in scope: the
+ * slot holding its entry, or the empty slot where
+ * the entry belongs
+ */
+static BucketList *slotOf(ScopeList scope, char *name)
+{
+  unsigned int mask = scope->slotCount - 1;
+  unsigned int i = hash(name) & mask;
+
+  while (scope->slots[i] != NULL && scope->slots[i]->name != name)
+    i = (i + 1) & mask;
+  return &scope->slots[i];
+}
+
+/* lookup finds the entry of name in scope, or NULL */
+static BucketList lookup(ScopeList scope, char *name)
+{
+  BucketList l = *slotOf(scope, name);
+
+  if (scope == limitedScope && l != NULL && l->memloc >= limitLocation)
+    return NULL;
+  return l;
+}
+
+/* growScope doubles the table of scope */
+static void growScope(ScopeList scope)
+{
+  BucketList l;
+
+  scope->slotCount *= 2;
+  scope->slots = (BucketList *)arenaAlloc(scope->arena, scope->slotCount * sizeof(BucketList));
+  for (l = scope->entries; l != NULL; l = l->next)
+    *slotOf(scope, l->name) = l;
+}
+
+/* appendPos appends a position to the list that
+ * starts at *first and ends at *last
+ */
+static void appendPos(Arena *arena, LineList *first, LineList *last,
+                      int lineno, int column)
+{
+  LineList chunk = *last;
+
+  if (chunk == NULL || chunk->count == chunk->capacity)
+  {
+    int capacity = chunk == NULL ? LINE_CHUNK : 2 * chunk->capacity;
+    LineList fresh = (LineList)arenaAlloc(arena, sizeof(struct LineListRec) +
+                                                     (capacity - 1) * sizeof(SourcePos));
+    fresh->capacity = capacity;
+    if (chunk == NULL)
+      *first = fresh;
+    else
+      chunk->next = fresh;
+    *last = chunk = fresh;
+  }
+  chunk->pos[chunk->count].lineno = lineno;
+  chunk->pos[chunk->count].column = column;
+  chunk->count++;
+}
+
+/* currentEntry finds the entry of name in the top
+ * scope, or NULL; on a shadow stack, only the top
+ * scope's declarations have its depth
+ */
+static BucketList currentEntry(char *name)
+{
+  ScopeList scope = get_top_scope();
+  BucketList l;
+
+  if (!shadowStacks)
+    return lookup(scope, name);
+  l = atomOf(name)->visible;
+  return l != NULL && l->depth == scope->depth ? l : NULL;
+}
+
 /* Procedure st_insert inserts line numbers and
  * memory locations into the symbol table
  * loc = memory location is inserted only the
@@ -80,24 +264,31 @@ ScopeList get_top_scope()
  */
 void st_insert(char *name, int lineno, int loc, TreeNode *treeNode)
 {
-  int h = hash(name);
   ScopeList scope = get_top_scope();
-  BucketList l = scope->hashTable[h];
-
-  while ((l != NULL) && (strcmp(name, l->name) != 0))
-    l = l->next;
+  BucketList *slot = shadowStacks ? NULL : slotOf(scope, name);
+  BucketList l = slot != NULL ? *slot : currentEntry(name);
 
   if (l == NULL) /* variable not yet in table */
   {
-    l = (BucketList)malloc(sizeof(struct BucketListRec));
+    l = (BucketList)arenaAlloc(scope->arena, sizeof(struct BucketListRec));
     l->name = name;
-    l->lines = (LineList)malloc(sizeof(struct LineListRec));
-    l->lines->lineno = lineno;
+    l->defined.lineno = lineno;
+    l->defined.column = treeNode->column;
+    l->scope = scope;
     l->memloc = loc;
-    l->lines->next = NULL;
-    l->next = scope->hashTable[h];
-    scope->hashTable[h] = l;
+    l->depth = scope->depth;
+    l->next = scope->entries;
+    scope->entries = l;
     l->treeNode = treeNode;
+    scope->entryCount++;
+    if (shadowStacks)
+      showEntry(l);
+    else
+    {
+      *slot = l;
+      if (4 * scope->entryCount > 3 * scope->slotCount)
+        growScope(scope);
+    }
   }
   // else /* found in table, so just add line number */
   // {
@@ -112,24 +303,28 @@ void st_insert(char *name, int lineno, int loc, TreeNode *treeNode)
 
 void st_insert_lineno(char *name, int lineno)
 {
-  int h = hash(name);
   ScopeList scope = get_top_scope();
-  BucketList bucket = scope->hashTable[h];
-
-  while ((bucket != NULL) && (strcmp(name, bucket->name) != 0))
-    bucket = bucket->next;
+  BucketList bucket = currentEntry(name);
 
   if (bucket != NULL) /* variable not yet in table */
-  {
-    LineList line = bucket->lines;
+    appendPos(scope->arena, &bucket->lines, &bucket->lastLines, lineno, 0);
+}
+
+void st_add_use(BucketList l, int lineno, int column)
+{
+  appendPos(l->scope->arena, &l->uses, &l->lastUses, lineno, column);
+  l->useCount++;
+}
 
-    while (line->next != NULL)
-      line = line->next;
+void st_print_lines(FILE *listing, BucketList l, const char *format)
+{
+  LineList chunk;
+  int i;
 
-    line->next = (LineList)malloc(sizeof(struct LineListRec));
-    line->next->lineno = lineno;
-    line->next->next = NULL;
-  }
+  fprintf(listing, format, l->defined.lineno);
+  for (chunk = l->lines; chunk != NULL; chunk = chunk->next)
+    for (i = 0; i < chunk->count; i++)
+      fprintf(listing, format, chunk->pos[i].lineno);
 }
 
 /* Function st_lookup returns the memory
@@ -146,14 +341,13 @@ int st_lookup(char *name)
 
 BucketList st_lookup_return_bucket(char *name)
 {
-  int h = hash(name);
   ScopeList scope = get_top_scope();
 
+  if (shadowStacks)
+    return atomOf(name)->visible;
   while (scope != NULL)
   {
-    BucketList bucket = scope->hashTable[h];
-    while ((bucket != NULL) && (strcmp(name, bucket->name) != 0))
-      bucket = bucket->next;
+    BucketList bucket = lookup(scope, name);
     if (bucket != NULL)
       return bucket;
     scope = scope->parent;
@@ -163,12 +357,7 @@ BucketList st_lookup_return_bucket(char *name)
 
 int st_lookup_current_scope(char *name)
 {
-  int h = hash(name);
-  ScopeList scope = get_top_scope();
-  BucketList bucket = scope->hashTable[h];
-
-  while ((bucket != NULL) && (strcmp(name, bucket->name) != 0))
-    bucket = bucket->next;
+  BucketList bucket = currentEntry(name);
 
   if (bucket == NULL)
     return -1;
@@ -182,90 +371,306 @@ int st_lookup_current_scope(char *name)
  */
 void printSymTab(FILE *listing)
 {
-  int i;
   fprintf(listing, "< Symbol Table >\n");
   fprintf(listing, " Symbol Name   Symbol Kind   Symbol Type    Scope Name   Location  Line Numbers\n");
   fprintf(listing, "-------------  -----------  -------------  ------------  --------  ------------\n");
-  for (i = 0; i < sizeOfScopeList; ++i)
+  printScopes(listing, 0, sizeOfScopeList);
+} /* printSymTab */
+
+void printScopes(FILE *listing, int first, int count)
+{
+  int i;
+  BucketList *sorted = NULL;
+  int sortedSize = 0;
+  for (i = first; i < first + count; ++i)
   {
     ScopeList scope = scopeList[i];
-    BucketList *hashTable = scope->hashTable;
-
-    for (int j = 0; j < SIZE; ++j)
+    int bucketStart[SIZE + 1];
+    TreeNode *treeNode = NULL;
+    BucketList l;
+    int j;
+
+    /* entries are listed by bucket, newest first, as
+     * the chained table listed them; kind and type
+     * come from the newest entry of a bucket
+     */
+    if (scope->entryCount > sortedSize)
     {
-      if (hashTable[j] == NULL)
-        continue;
-
-      BucketList l = hashTable[j];
-      TreeNode *treeNode = l->treeNode;
-
-      while (l != NULL)
+      sortedSize = scope->entryCount;
+      sorted = (BucketList *)realloc(sorted, sortedSize * sizeof(BucketList));
+      if (sorted == NULL)
       {
-        fprintf(listing, "%-13s  ", l->name);
+        fprintf(stderr, "Out of memory listing the symbol table\n");
+        exit(1);
+      }
+    }
+    memset(bucketStart, 0, sizeof(bucketStart));
+    for (l = scope->entries; l != NULL; l = l->next)
+      bucketStart[atomOf(l->name)->bucket + 1]++;
+    for (j = 0; j < SIZE; ++j)
+      bucketStart[j + 1] += bucketStart[j];
+    for (l = scope->entries; l != NULL; l = l->next)
+      sorted[bucketStart[atomOf(l->name)->bucket]++] = l;
+
+    for (j = 0; j < scope->entryCount; ++j)
+    {
+      l = sorted[j];
+      if (j == 0 || atomOf(l->name)->bucket != atomOf(sorted[j - 1]->name)->bucket)
+        treeNode = l->treeNode;
+      fprintf(listing, "%-13s  ", l->name);
 
-        switch (treeNode->nodekind)
+      switch (treeNode->nodekind)
+      {
+      case VarDeclK:
+        fprintf(listing, "%-11s  ", "Variable");
+        switch (treeNode->type)
         {
-        case VarDeclK:
-          fprintf(listing, "%-11s  ", "Variable");
-          switch (treeNode->type)
-          {
-          case Int:
-            fprintf(listing, "%-13s  ", "int");
-            break;
-          case IntArray:
-            fprintf(listing, "%-13s  ", "int[]");
-            break;
-          default:
-            break;
-          }
+        case Int:
+          fprintf(listing, "%-13s  ", "int");
           break;
-
-        case FunDeclK:
-          fprintf(listing, "%-11s  ", "Function");
-          switch (treeNode->type)
-          {
-          case Int:
-            fprintf(listing, "%-13s  ", "int");
-            break;
-          case Void:
-            fprintf(listing, "%-13s  ", "void");
-            break;
-          default:
-            break;
-          }
+        case IntArray:
+          fprintf(listing, "%-13s  ", "int[]");
+          break;
+        default:
           break;
+        }
+        break;
 
-        case ParamK:
-          fprintf(listing, "%-11s  ", "Variable");
-          switch (treeNode->type)
-          {
-          case Int:
-            fprintf(listing, "%-13s  ", "int");
-            break;
-          case IntArray:
-            fprintf(listing, "%-13s  ", "int[]");
-            break;
-          default:
-            break;
-          }
+      case FunDeclK:
+        fprintf(listing, "%-11s  ", "Function");
+        switch (treeNode->type)
+        {
+        case Int:
+          fprintf(listing, "%-13s  ", "int");
           break;
+        case Void:
+          fprintf(listing, "%-13s  ", "void");
+          break;
+        default:
+          break;
+        }
+        break;
 
+      case ParamK:
+        fprintf(listing, "%-11s  ", "Variable");
+        switch (treeNode->type)
+        {
+        case Int:
+          fprintf(listing, "%-13s  ", "int");
+          break;
+        case IntArray:
+          fprintf(listing, "%-13s  ", "int[]");
+          break;
         default:
           break;
         }
+        break;
+
+      default:
+        break;
+      }
+
+      fprintf(listing, "%-13s  ", scope->name);
+      fprintf(listing, "%-8d  ", l->memloc);
+
+      st_print_lines(listing, l, "%3d ");
+      fprintf(listing, "\n");
+    }
+  }
+  free(sorted);
+} /* printScopes */
+static unsigned int symbolKind(TreeNode *t)
+{
+  switch (t->nodekind)
+  {
+  case FunDeclK:
+    return SYM_FUNCTION;
+  case ParamK:
+    return SYM_PARAMETER;
+  default:
+    return SYM_VARIABLE;
+  }
+}
+
+static unsigned int symbolType(NodeType type)
+{
+  switch (type)
+  {
+  case Int:
+    return SYM_INT;
+  case Void:
+    return SYM_VOID;
+  case IntArray:
+    return SYM_INT_ARRAY;
+  case VoidArray:
+    return SYM_VOID_ARRAY;
+  default:
+    return SYM_UNDETERMINED;
+  }
+}
 
-        fprintf(listing, "%-13s  ", scope->name);
-        fprintf(listing, "%-8d  ", l->memloc);
+/* nameOffset returns the offset of name in the
+ * string section, adding it on first use; offsets
+ * are remembered by atom id
+ */
+static unsigned int nameOffset(char *name, unsigned int *offsets,
+                               char *strings, unsigned int *stringSize)
+{
+  Atom atom = atomOf(intern(name));
+  if (offsets[atom->id] == 0)
+  {
+    offsets[atom->id] = *stringSize;
+    if (strings != NULL)
+      memcpy(strings + *stringSize, atom->name, atom->length + 1);
+    *stringSize += atom->length + 1;
+  }
+  return offsets[atom->id];
+}
 
-        LineList t = l->lines;
-        while (t != NULL)
+int writeSymtabFile(const char *path)
+{
+  SymFileHeader h;
+  SymFileScope *scopes;
+  SymFileSymbol *symbols;
+  SymFileRef *refs;
+  unsigned int *index, *offsets;
+  char *file, *strings;
+  char temp[1100];
+  unsigned int stringSize, s, r;
+  LineList chunk;
+  BucketList l;
+  FILE *f;
+  int i, k, ok, fd;
+
+  /* the names go first, to size the string section;
+   * offset 0 is the empty string
+   */
+  for (i = 0; i < sizeOfScopeList; i++)
+    intern(scopeList[i]->name);
+  offsets = (unsigned int *)calloc(atomCount() + 1, sizeof(unsigned int));
+  if (offsets == NULL)
+    return FALSE;
+  stringSize = 1;
+  memset(&h, 0, sizeof(h));
+  for (i = 0; i < sizeOfScopeList; i++)
+  {
+    nameOffset(scopeList[i]->name, offsets, NULL, &stringSize);
+    h.scopeCount++;
+    for (l = scopeList[i]->entries; l != NULL; l = l->next)
+    {
+      nameOffset(l->name, offsets, NULL, &stringSize);
+      h.symbolCount++;
+      h.refCount += l->useCount;
+      for (chunk = l->lines; chunk != NULL; chunk = chunk->next)
+        h.refCount += chunk->count;
+    }
+  }
+  for (h.indexSize = 2; h.indexSize < 2 * h.symbolCount; h.indexSize *= 2)
+    ;
+  memcpy(h.magic, SYMFILE_MAGIC, sizeof(h.magic));
+  h.version = SYMFILE_VERSION;
+  h.scopeOffset = sizeof(SymFileHeader);
+  h.symbolOffset = h.scopeOffset + h.scopeCount * sizeof(SymFileScope);
+  h.refOffset = h.symbolOffset + h.symbolCount * sizeof(SymFileSymbol);
+  h.indexOffset = h.refOffset + h.refCount * sizeof(SymFileRef);
+  h.stringOffset = h.indexOffset + h.indexSize * sizeof(unsigned int);
+  h.stringSize = stringSize;
+  h.fileSize = h.stringOffset + h.stringSize;
+
+  file = (char *)calloc(h.fileSize, 1);
+  if (file == NULL)
+  {
+    free(offsets);
+    return FALSE;
+  }
+  memcpy(file, &h, sizeof(h));
+  scopes = (SymFileScope *)(file + h.scopeOffset);
+  symbols = (SymFileSymbol *)(file + h.symbolOffset);
+  refs = (SymFileRef *)(file + h.refOffset);
+  index = (unsigned int *)(file + h.indexOffset);
+  strings = file + h.stringOffset;
+  memset(offsets, 0, (atomCount() + 1) * sizeof(unsigned int));
+  stringSize = 1;
+
+  s = r = 0;
+  for (i = 0; i < sizeOfScopeList; i++)
+  {
+    ScopeList scope = scopeList[i];
+    SymFileSymbol *sym;
+
+    scopes[i].name = nameOffset(scope->name, offsets, strings, &stringSize);
+    scopes[i].parent = scope->parent != NULL ? scope->parent->number : -1;
+    scopes[i].depth = scope->depth;
+    scopes[i].firstSymbol = s;
+    scopes[i].symbolCount = scope->entryCount;
+    /* entries are linked newest first; the file
+     * lists them in order of insertion
+     */
+    s += scope->entryCount;
+    sym = &symbols[s];
+    for (l = scope->entries; l != NULL; l = l->next)
+    {
+      unsigned int slot = symFileHash(l->name) & (h.indexSize - 1);
+      sym--;
+      sym->name = nameOffset(l->name, offsets, strings, &stringSize);
+      sym->scope = i;
+      sym->kind = symbolKind(l->treeNode);
+      sym->type = symbolType(l->treeNode->type);
+      sym->memloc = l->memloc;
+      sym->line = l->defined.lineno;
+      sym->column = l->defined.column;
+      sym->firstRef = r;
+      for (chunk = l->lines; chunk != NULL; chunk = chunk->next)
+        for (k = 0; k < chunk->count; k++, r++)
         {
-          fprintf(listing, "%3d ", t->lineno);
-          t = t->next;
+          refs[r].line = chunk->pos[k].lineno;
+          refs[r].column = chunk->pos[k].column;
+          sym->lineCount++;
         }
-        fprintf(listing, "\n");
-        l = l->next;
-      }
+      for (chunk = l->uses; chunk != NULL; chunk = chunk->next)
+        for (k = 0; k < chunk->count; k++, r++)
+        {
+          refs[r].line = chunk->pos[k].lineno;
+          refs[r].column = chunk->pos[k].column;
+        }
+      sym->useCount = l->useCount;
+      while (index[slot] != 0)
+        slot = (slot + 1) & (h.indexSize - 1);
+      index[slot] = sym - symbols + 1;
     }
   }
-} /* printSymTab */
\ No newline at end of file
+  free(offsets);
+
+  /* written under a temporary name of its own and
+   * renamed, so a reader never maps a partial file
+   * and writers of the same path do not mix
+   */
+  snprintf(temp, sizeof(temp), "%s.XXXXXX", path);
+  fd = mkstemp(temp);
+  f = NULL;
+  if (fd >= 0)
+  {
+    fchmod(fd, 0644);
+    f = fdopen(fd, "wb");
+    if (f == NULL)
+    {
+      close(fd);
+      remove(temp);
+    }
+  }
+  if (f == NULL)
+  {
+    free(file);
+    return FALSE;
+  }
+  ok = fwrite(file, 1, h.fileSize, f) == h.fileSize;
+  if (fclose(f) != 0)
+    ok = FALSE;
+  if (!ok || rename(temp, path) != 0)
+  {
+    remove(temp);
+    ok = FALSE;
+  }
+  free(file);
+  return ok;
+}
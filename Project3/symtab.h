@@ -10,46 +10,140 @@
 #define _SYMTAB_H_
 
 #include "globals.h"
-/* SIZE is the size of the hash table */
+#include "arena.h"
+/* SIZE is the number of hash buckets the listing
+ * is ordered by (see atom.h)
+ */
 #define SIZE 211
 
-/* the list of line numbers of the source
- * code in which a variable is referenced
+/* slots in a new scope's table, kept in the scope */
+#define SCOPE_INLINE_SLOTS 4
+
+/* SourcePos is a place in the source code */
+typedef struct
+{
+    int lineno;
+    int column; /* from 1, 0 if unknown */
+} SourcePos;
+
+/* positions in the first chunk of a LineList */
+#define LINE_CHUNK 4
+
+/* A LineList holds source positions in chunks; each
+ * chunk has twice the room of the one before, so an
+ * append is O(1) through the list's last chunk
  */
 typedef struct LineListRec
 {
-    int lineno;
     struct LineListRec *next;
+    int count;    /* positions used */
+    int capacity; /* positions allocated */
+    SourcePos pos[1];
 } *LineList;
 
 /* The record in the bucket lists for
  * each variable, including name,
  * assigned memory location, and
  * the list of line numbers in which
- * it appears in the source code
+ * it appears in the source code:
+ * defined.lineno and then lines
  */
 typedef struct BucketListRec
 {
     char *name;
-    LineList lines;
+    SourcePos defined; /* position given to st_insert */
+    LineList lines, lastLines;
+    LineList uses, lastUses; /* every use, with xrefIndex */
+    int useCount;
+    struct ScopeListRec *scope; /* declaring scope */
     int memloc; /* memory location for variable */
-    struct BucketListRec *next;
+    int depth;  /* nesting depth of the declaring scope */
+    struct BucketListRec *next; /* entry of the scope inserted before */
+    struct BucketListRec *shadowed; /* declaration hidden by this one */
     TreeNode *treeNode;
 } *BucketList;
 
+/* A scope's entries are found through an open
+ * addressing table of slotCount slots (a power of
+ * two), at most three quarters full; it starts in
+ * inlineSlots and doubles in the scope's arena
+ */
 typedef struct ScopeListRec
 {
     char *name;
-    BucketList hashTable[SIZE];
+    BucketList *slots;
+    int slotCount;
+    int entryCount;
+    BucketList entries; /* newest first */
+    BucketList inlineSlots[SCOPE_INLINE_SLOTS];
     struct ScopeListRec *parent;
+    int depth; /* 0 for the global scope */
+    int number; /* position in the list of scopes */
+    Arena *arena; /* holds the scope and its entries */
 } *ScopeList;
 
+/* With shadowStacks set, names are resolved through
+ * one table, the atoms: each atom holds the stack of
+ * its visible declarations, innermost first, linked
+ * through shadowed. push_scope and pop_scope push and
+ * pop the declarations of a scope, so a lookup costs
+ * the same at any depth. Otherwise (the default) each
+ * scope's own table is searched from the top scope
+ * outwards. Scopes must be pushed and popped in
+ * nested order either way
+ */
+extern _Thread_local int shadowStacks;
+
+/* scopeArena is the arena of the scopes created
+ * from now on (symtabArena if NULL)
+ */
+extern _Thread_local Arena *scopeArena;
+
 int addLocation();
 void push_scope(ScopeList scope);
 void pop_scope();
 ScopeList get_top_scope();
 ScopeList create_scope(char *name);
 
+/* scope_count returns the number of scopes created
+ * so far; release_scopes forgets all but the first
+ * count of them, whose arena the caller frees;
+ * free_scopes forgets them all and frees the arrays
+ * that hold them, for a thread that ends
+ */
+int scope_count();
+void release_scopes(int count);
+void free_scopes();
+
+/* get_scope returns the i-th scope created,
+ * 0 <= i < scope_count()
+ */
+ScopeList get_scope(int i);
+
+/* Each thread has its own scope stack, list of
+ * scopes and scopeArena, so that function bodies can
+ * be analyzed side by side (see analyzeParallel).
+ * take_scopes returns the scopes the calling thread
+ * created, in order, and forgets them along with its
+ * scope stack; append_scopes adds such scopes to the
+ * calling thread's list. The caller frees the array
+ */
+ScopeList *take_scopes(int *count);
+void append_scopes(ScopeList *scopes, int count);
+
+/* limit_scope makes the calling thread's lookups in
+ * scope see only the entries with memory locations
+ * below locations: the scope as it was when its
+ * location counter stood there. A NULL scope lifts
+ * the limit
+ */
+void limit_scope(ScopeList scope, int locations);
+
+/* All names passed to the symbol table must be
+ * interned (see atom.h): entries are found by
+ * pointer identity and the precomputed hash
+ */
+
 /* Procedure st_insert inserts line numbers and
  * memory locations into the symbol table
  * loc = memory location is inserted only the
@@ -59,6 +153,18 @@ void st_insert(char *name, int lineno, int loc, TreeNode *treeNode);
 
 void st_insert_lineno(char *name, int lineno);
 
+/* With xrefIndex set, the analyzer records every
+ * use of a name with st_add_use, for the
+ * cross-reference index (xref.h)
+ */
+extern _Thread_local int xrefIndex;
+void st_add_use(BucketList l, int lineno, int column);
+
+/* Procedure st_print_lines prints the line numbers
+ * of l, each with the given printf format
+ */
+void st_print_lines(FILE *listing, BucketList l, const char *format);
+
 /* Function st_lookup returns the memory
  * location of a variable or -1 if not found
  */
@@ -74,6 +180,18 @@ int st_lookup_current_scope(char *name);
  */
 void printSymTab(FILE *listing);
 
+/* Procedure printScopes prints the lines of the
+ * listing for count scopes from the first-th one
+ */
+void printScopes(FILE *listing, int first, int count);
+
 void printFunc(FILE *listing);
 
+/* Function writeSymtabFile writes the symbol table,
+ * with the uses recorded under xrefIndex, to a file
+ * for tools (see symfile.h); returns FALSE if it
+ * cannot
+ */
+int writeSymtabFile(const char *path);
+
 #endif
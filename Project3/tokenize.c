@@ -0,0 +1,694 @@
+/****************************************************/
+/* File: tokenize.c                                 */
+/* Buffer tokenizer for the C-MINUS compiler        */
+/* Scans an in-memory source buffer into a token    */
+/* array, optionally on several threads. Follows    */
+/* the rules of cminus.l exactly, so the result is  */
+/* token-for-token identical to getToken()          */
+/****************************************************/
+
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "globals.h"
+#include "scan.h"
+#include "tokenize.h"
+
+/* chunks smaller than this are not worth a thread */
+#ifndef PARALLEL_MIN_CHUNK
+#define PARALLEL_MIN_CHUNK (64 * 1024)
+#endif
+
+char *readSource(FILE *file, int *length)
+{
+  int size = 0;
+  int capacity = 64 * 1024;
+  char *text = (char *)malloc(capacity + 1);
+  size_t n;
+  if (text == NULL)
+  {
+    fprintf(stderr, "Out of memory reading source\n");
+    exit(1);
+  }
+  while ((n = fread(text + size, 1, capacity - size, file)) > 0)
+  {
+    size += n;
+    if (size == capacity)
+    {
+      capacity *= 2;
+      text = (char *)realloc(text, capacity + 1);
+      if (text == NULL)
+      {
+        fprintf(stderr, "Out of memory reading source\n");
+        exit(1);
+      }
+    }
+  }
+  text[size] = '\0';
+  *length = size;
+  return text;
+}
+
+static void initTokenArray(TokenArray *tokens, const char *text, int length)
+{
+  tokens->text = text;
+  tokens->textLength = length;
+  tokens->tokens = NULL;
+  tokens->size = 0;
+  tokens->capacity = 0;
+}
+
+static void addToken(TokenArray *tokens, TokenType type, int lineno, int column,
+                     int offset, int length)
+{
+  Token *t;
+  if (tokens->size == tokens->capacity)
+  {
+    tokens->capacity = tokens->capacity ? tokens->capacity * 2 : 256;
+    tokens->tokens = (Token *)realloc(tokens->tokens, tokens->capacity * sizeof(Token));
+    if (tokens->tokens == NULL)
+    {
+      fprintf(stderr, "Out of memory in tokenizer\n");
+      exit(1);
+    }
+  }
+  t = &tokens->tokens[tokens->size++];
+  t->type = type;
+  t->lineno = lineno;
+  t->column = column;
+  t->offset = offset;
+  t->length = length;
+}
+
+void freeTokenArray(TokenArray *tokens)
+{
+  if (tokens == NULL)
+    return;
+  free(tokens->tokens);
+  free(tokens);
+}
+
+#define isLetter(c) (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z'))
+#define isDigit(c) ((c) >= '0' && (c) <= '9')
+
+/* reservedLookup returns the reserved word token
+ * of s[0..n) or ID
+ */
+static TokenType reservedLookup(const char *s, int n)
+{
+  switch (n)
+  {
+  case 2:
+    if (memcmp(s, "if", 2) == 0)
+      return IF;
+    break;
+  case 3:
+    if (memcmp(s, "int", 3) == 0)
+      return INT;
+    break;
+  case 4:
+    if (memcmp(s, "else", 4) == 0)
+      return ELSE;
+    if (memcmp(s, "void", 4) == 0)
+      return VOID;
+    break;
+  case 5:
+    if (memcmp(s, "while", 5) == 0)
+      return WHILE;
+    break;
+  case 6:
+    if (memcmp(s, "return", 6) == 0)
+      return RETURN;
+    break;
+  }
+  return ID;
+}
+
+/* skipComment consumes comment text starting at
+ * text[i] the way the comment action of cminus.l
+ * does: it stops after a '*' '/' pair, a NUL or an
+ * EOF character.
+ * prev is the character read before text[i].
+ * *line and *lineStart follow the newlines in it.
+ * Returns the index after the comment, or end if
+ * the comment is still open at end (*closed = FALSE)
+ */
+static int skipComment(const char *text, int i, int end, char prev,
+                       int *line, int *lineStart, int *closed)
+{
+  while (i < end)
+  {
+    char c = text[i++];
+    if (c == (char)EOF || c == '\0')
+    {
+      *closed = TRUE;
+      return i;
+    }
+    if (c == '\n')
+    {
+      (*line)++;
+      *lineStart = i;
+    }
+    if (c == '/' && prev == '*')
+    {
+      *closed = TRUE;
+      return i;
+    }
+    prev = c;
+  }
+  *closed = FALSE;
+  return end;
+}
+
+int lexToken(const char *text, int *pos, int end, int *line,
+             int *lineStart, Token *token, int *open)
+{
+  int i = *pos;
+  int closed;
+
+  *open = FALSE;
+  while (i < end)
+  {
+    int start = i;
+    char c = text[i++];
+    TokenType type;
+
+    if (isLetter(c))
+    {
+      while (i < end && (isLetter(text[i]) || isDigit(text[i])))
+        i++;
+      type = reservedLookup(text + start, i - start);
+    }
+    else if (isDigit(c))
+    {
+      while (i < end && isDigit(text[i]))
+        i++;
+      type = NUM;
+    }
+    else
+    {
+      switch (c)
+      {
+      case '\n':
+        (*line)++;
+        *lineStart = i;
+        continue;
+      case ' ':
+      case '\t':
+        continue;
+      case '/':
+        if (i < end && text[i] == '*')
+        {
+          i = skipComment(text, i + 1, end, '\0', line, lineStart, &closed);
+          if (!closed)
+          {
+            *open = TRUE;
+            *pos = end;
+            return FALSE;
+          }
+          continue;
+        }
+        type = OVER;
+        break;
+      case '=':
+        type = ASSIGN;
+        if (i < end && text[i] == '=')
+        {
+          type = EQ;
+          i++;
+        }
+        break;
+      case '!':
+        type = ERROR;
+        if (i < end && text[i] == '=')
+        {
+          type = NE;
+          i++;
+        }
+        break;
+      case '<':
+        type = LT;
+        if (i < end && text[i] == '=')
+        {
+          type = LE;
+          i++;
+        }
+        break;
+      case '>':
+        type = GT;
+        if (i < end && text[i] == '=')
+        {
+          type = GE;
+          i++;
+        }
+        break;
+      case '+':
+        type = PLUS;
+        break;
+      case '-':
+        type = MINUS;
+        break;
+      case '*':
+        type = TIMES;
+        break;
+      case '(':
+        type = LPAREN;
+        break;
+      case ')':
+        type = RPAREN;
+        break;
+      case '[':
+        type = LBRACE;
+        break;
+      case ']':
+        type = RBRACE;
+        break;
+      case '{':
+        type = LCURLY;
+        break;
+      case '}':
+        type = RCURLY;
+        break;
+      case ';':
+        type = SEMI;
+        break;
+      case ',':
+        type = COMMA;
+        break;
+      default:
+        type = ERROR;
+        break;
+      }
+    }
+    token->type = type;
+    token->lineno = *line;
+    token->column = start - *lineStart + 1;
+    token->offset = start;
+    token->length = i - start;
+    *pos = i;
+    return TRUE;
+  }
+  *pos = end;
+  return FALSE;
+}
+
+int scanChunk(const char *text, int begin, int end,
+              int startLine, int inComment, TokenArray *tokens)
+{
+  int i = begin;
+  int line = startLine;
+  int lineStart = begin;
+  int open, closed;
+  Token token;
+
+  /* chunks begin after a newline, so the character
+   * read before an inherited comment is '\n'
+   */
+  if (inComment)
+  {
+    i = skipComment(text, i, end, '\n', &line, &lineStart, &closed);
+    if (!closed)
+      return TRUE;
+  }
+  while (lexToken(text, &i, end, &line, &lineStart, &token, &open))
+    addToken(tokens, token.type, token.lineno, token.column, token.offset, token.length);
+  return open;
+}
+
+/* Function commentState runs only the comment part
+ * of the scanner over text[begin..end) and returns
+ * whether the chunk ends inside a comment, given
+ * whether it starts inside one
+ */
+static int commentState(const char *text, int begin, int end, int inComment)
+{
+  int i = begin;
+  int line = 0, lineStart = 0;
+  int closed;
+  if (inComment)
+  {
+    i = skipComment(text, i, end, '\n', &line, &lineStart, &closed);
+    if (!closed)
+      return TRUE;
+  }
+  while (i < end)
+  {
+    const char *slash = memchr(text + i, '/', end - i);
+    if (slash == NULL)
+      break;
+    i = slash - text + 1;
+    if (i < end && text[i] == '*')
+    {
+      i = skipComment(text, i + 1, end, '\0', &line, &lineStart, &closed);
+      if (!closed)
+        return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+static int countLines(const char *text, int begin, int end)
+{
+  int n = 0;
+  const char *p = text + begin;
+  const char *stop = text + end;
+  while ((p = memchr(p, '\n', stop - p)) != NULL)
+  {
+    n++;
+    p++;
+  }
+  return n;
+}
+
+TokenArray *scanBuffer(const char *text, int length)
+{
+  TokenArray *tokens = (TokenArray *)malloc(sizeof(TokenArray));
+  initTokenArray(tokens, text, length);
+  scanChunk(text, 0, length, 1, FALSE, tokens);
+  addToken(tokens, ENDFILE, 1 + countLines(text, 0, length), 0, length, 0);
+  return tokens;
+}
+
+/* per-chunk work record of scanParallel */
+typedef struct
+{
+  const char *text;
+  int begin, end;
+  int newlines;      /* number of '\n' in the chunk */
+  int exitState[2];  /* ends in comment, per entry state */
+  int startLine;
+  int inComment;     /* entry state, known after the pre-pass */
+  TokenArray tokens;
+} ChunkRec;
+
+static void *prepassChunk(void *arg)
+{
+  ChunkRec *c = (ChunkRec *)arg;
+  c->newlines = countLines(c->text, c->begin, c->end);
+  c->exitState[FALSE] = commentState(c->text, c->begin, c->end, FALSE);
+  c->exitState[TRUE] = commentState(c->text, c->begin, c->end, TRUE);
+  return NULL;
+}
+
+static void *lexChunk(void *arg)
+{
+  ChunkRec *c = (ChunkRec *)arg;
+  scanChunk(c->text, c->begin, c->end, c->startLine, c->inComment, &c->tokens);
+  return NULL;
+}
+
+/* runChunks applies work to every chunk, one
+ * thread per chunk beyond the first
+ */
+static void runChunks(ChunkRec *chunks, int n, void *(*work)(void *))
+{
+  pthread_t *threads = (pthread_t *)malloc(n * sizeof(pthread_t));
+  int i;
+  for (i = 1; i < n; i++)
+    if (pthread_create(&threads[i], NULL, work, &chunks[i]) != 0)
+      threads[i] = 0;
+  work(&chunks[0]);
+  for (i = 1; i < n; i++)
+  {
+    if (threads[i] != 0)
+      pthread_join(threads[i], NULL);
+    else
+      work(&chunks[i]);
+  }
+  free(threads);
+}
+
+TokenArray *scanParallel(const char *text, int length, int nthreads)
+{
+  TokenArray *tokens;
+  ChunkRec *chunks;
+  int nchunks, i, begin, total, line;
+
+  if (nthreads <= 0)
+    nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  nchunks = length / PARALLEL_MIN_CHUNK;
+  if (nchunks > nthreads)
+    nchunks = nthreads;
+  if (nchunks <= 1)
+    return scanBuffer(text, length);
+
+  /* split at newline boundaries */
+  chunks = (ChunkRec *)malloc(nchunks * sizeof(ChunkRec));
+  begin = 0;
+  for (i = 0; i < nchunks && begin < length; i++)
+  {
+    int end = (int)((long long)length * (i + 1) / nchunks);
+    if (end <= begin)
+      end = begin + 1;
+    if (i == nchunks - 1)
+      end = length;
+    else
+    {
+      const char *nl = memchr(text + end - 1, '\n', length - (end - 1));
+      end = nl == NULL ? length : (int)(nl - text) + 1;
+    }
+    chunks[i].text = text;
+    chunks[i].begin = begin;
+    chunks[i].end = end;
+    initTokenArray(&chunks[i].tokens, text, length);
+    begin = end;
+  }
+  nchunks = i;
+
+  /* resolve where each chunk starts: line number
+   * and whether it is inside a comment
+   */
+  runChunks(chunks, nchunks, prepassChunk);
+  line = 1;
+  chunks[0].inComment = FALSE;
+  for (i = 0; i < nchunks; i++)
+  {
+    chunks[i].startLine = line;
+    line += chunks[i].newlines;
+    if (i + 1 < nchunks)
+      chunks[i + 1].inComment = chunks[i].exitState[chunks[i].inComment];
+  }
+
+  runChunks(chunks, nchunks, lexChunk);
+
+  /* stitch the chunk token arrays together */
+  total = 1;
+  for (i = 0; i < nchunks; i++)
+    total += chunks[i].tokens.size;
+  tokens = (TokenArray *)malloc(sizeof(TokenArray));
+  initTokenArray(tokens, text, length);
+  tokens->tokens = (Token *)malloc(total * sizeof(Token));
+  tokens->capacity = total;
+  for (i = 0; i < nchunks; i++)
+  {
+    memcpy(tokens->tokens + tokens->size, chunks[i].tokens.tokens,
+           chunks[i].tokens.size * sizeof(Token));
+    tokens->size += chunks[i].tokens.size;
+    free(chunks[i].tokens.tokens);
+  }
+  addToken(tokens, ENDFILE, line, 0, length, 0);
+  free(chunks);
+  return tokens;
+}
+
+/* findTokenAt returns the index in [lo, hi) of the
+ * token starting at offset, or -1
+ */
+static int findTokenAt(const TokenArray *tokens, int lo, int hi, int offset)
+{
+  while (lo < hi)
+  {
+    int mid = lo + (hi - lo) / 2;
+    if (tokens->tokens[mid].offset < offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo < tokens->size && tokens->tokens[lo].offset == offset)
+    return lo;
+  return -1;
+}
+
+char *relexTokens(TokenArray *tokens, int offset, int removed,
+                  const char *inserted, int insertedLength,
+                  TokenRange *changed)
+{
+  const char *oldText = tokens->text;
+  int oldLength = tokens->textLength;
+  int newLength = oldLength - removed + insertedLength;
+  int delta = insertedLength - removed;
+  int lineDelta, resyncLine = 0, columnDelta = 0;
+  char *text;
+  TokenArray fresh;
+  Token token;
+  int lo, hi, first, resync, pos, line, lineStart, open, i, tail;
+
+  /* the edit must lie within the buffer */
+  if (offset < 0 || removed < 0 || insertedLength < 0 || offset > oldLength ||
+      removed > oldLength - offset || (inserted == NULL && insertedLength > 0) ||
+      insertedLength > INT_MAX - (oldLength - removed))
+    return NULL;
+
+  /* build the edited buffer */
+  text = (char *)malloc(newLength + 1);
+  if (text == NULL)
+  {
+    fprintf(stderr, "Out of memory in tokenizer\n");
+    exit(1);
+  }
+  memcpy(text, oldText, offset);
+  memcpy(text + offset, inserted, insertedLength);
+  memcpy(text + offset + insertedLength, oldText + offset + removed,
+         oldLength - offset - removed);
+  text[newLength] = '\0';
+  lineDelta = countLines(inserted, 0, insertedLength) - countLines(oldText, offset, offset + removed);
+
+  /* restart after the last token that ends before the
+   * edit: a token boundary is always outside comments,
+   * and a token followed by an unchanged character
+   * cannot be extended by the edit
+   */
+  lo = 0;
+  hi = tokens->size - 1; /* never the ENDFILE token */
+  while (lo < hi)
+  {
+    int mid = lo + (hi - lo) / 2;
+    if (tokens->tokens[mid].offset + tokens->tokens[mid].length < offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  first = lo;
+  if (first > 0)
+  {
+    const Token *last = &tokens->tokens[first - 1];
+    pos = last->offset + last->length;
+    line = last->lineno;
+    lineStart = last->offset - (last->column - 1);
+  }
+  else
+  {
+    pos = 0;
+    line = 1;
+    lineStart = 0;
+  }
+
+  /* re-lex until a new token starts where an old one
+   * started after the edit: from there on the text and
+   * the scanner state are the same, so are the tokens
+   */
+  initTokenArray(&fresh, text, newLength);
+  resync = -1;
+  while (lexToken(text, &pos, newLength, &line, &lineStart, &token, &open))
+  {
+    if (token.offset >= offset + insertedLength)
+    {
+      resync = findTokenAt(tokens, first, tokens->size - 1, token.offset - delta);
+      if (resync >= 0)
+      {
+        /* the rest of its line moved with it */
+        resyncLine = tokens->tokens[resync].lineno;
+        columnDelta = token.column - tokens->tokens[resync].column;
+        break;
+      }
+    }
+    addToken(&fresh, token.type, token.lineno, token.column, token.offset, token.length);
+  }
+  if (resync < 0)
+  {
+    addToken(&fresh, ENDFILE, line, 0, newLength, 0);
+    resync = tokens->size;
+  }
+
+  /* splice the new tokens in and shift the rest */
+  tail = tokens->size - resync;
+  if (first + fresh.size + tail > tokens->capacity)
+  {
+    tokens->capacity = first + fresh.size + tail;
+    tokens->tokens = (Token *)realloc(tokens->tokens, tokens->capacity * sizeof(Token));
+    if (tokens->tokens == NULL)
+    {
+      fprintf(stderr, "Out of memory in tokenizer\n");
+      exit(1);
+    }
+  }
+  memmove(tokens->tokens + first + fresh.size, tokens->tokens + resync, tail * sizeof(Token));
+  if (fresh.size > 0)
+    memcpy(tokens->tokens + first, fresh.tokens, fresh.size * sizeof(Token));
+  for (i = first + fresh.size; i < first + fresh.size + tail; i++)
+  {
+    if (tokens->tokens[i].lineno == resyncLine)
+      tokens->tokens[i].column += columnDelta;
+    tokens->tokens[i].offset += delta;
+    tokens->tokens[i].lineno += lineDelta;
+  }
+  tokens->size = first + fresh.size + tail;
+  tokens->text = text;
+  tokens->textLength = newLength;
+  free(fresh.tokens);
+
+  if (changed != NULL)
+  {
+    changed->first = first;
+    changed->oldEnd = resync;
+    changed->newEnd = first + fresh.size;
+  }
+  return text;
+}
+
+void tokenLexeme(const TokenArray *tokens, int t, char *buf)
+{
+  const Token *token = &tokens->tokens[t];
+  int n = token->length < MAXTOKENLEN ? token->length : MAXTOKENLEN;
+  memcpy(buf, tokens->text + token->offset, n);
+  buf[n] = '\0';
+}
+
+/* token array installed by useTokenArray */
+static _Thread_local TokenArray *arrayTokens = NULL;
+static _Thread_local int arrayPos = 0;
+
+void useTokenArray(TokenArray *tokens)
+{
+  arrayTokens = tokens;
+  arrayPos = 0;
+}
+
+TokenType nextArrayToken(void)
+{
+  int t;
+  if (arrayTokens == NULL)
+    return -1;
+  t = arrayPos;
+  if (arrayPos < arrayTokens->size - 1)
+    arrayPos++;
+  lineno = arrayTokens->tokens[t].lineno;
+  tokenLexeme(arrayTokens, t, tokenString);
+  if (arrayTokens->tokens[t].type == ID)
+    tokenColumn = arrayTokens->tokens[t].column;
+  return arrayTokens->tokens[t].type;
+}
+
+int arrayPosition(void)
+{
+  return arrayPos;
+}
+
+void seekTokenArray(int t)
+{
+  arrayPos = t;
+}
+
+void skipBlock(void)
+{
+  int depth = 1;
+  while (arrayPos < arrayTokens->size - 1)
+  {
+    TokenType type = arrayTokens->tokens[arrayPos].type;
+    if (type == LCURLY)
+      depth++;
+    else if (type == RCURLY && --depth == 0)
+      return;
+    arrayPos++;
+  }
+}
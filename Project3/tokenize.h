@@ -0,0 +1,140 @@
+/****************************************************/
+/* File: tokenize.h                                 */
+/* Buffer tokenizer interface for C-MINUS compiler  */
+/* (token arrays and parallel scanning)             */
+/****************************************************/
+
+#ifndef _TOKENIZE_H_
+#define _TOKENIZE_H_
+
+/* A Token records one lexeme of the source buffer.
+ * The lexeme itself is not copied: offset/length
+ * point into the buffer the token was scanned from
+ */
+typedef struct
+{
+  TokenType type;
+  int lineno; /* line of the token, same as lineno after getToken() */
+  int column; /* column (from 1) of the lexeme in its line */
+  int offset; /* byte offset of the lexeme in the source buffer */
+  int length; /* length of the lexeme */
+} Token;
+
+/* TokenArray holds the whole token stream of a
+ * source buffer, terminated by an ENDFILE token
+ */
+typedef struct
+{
+  const char *text; /* source buffer the tokens refer to */
+  int textLength;
+  Token *tokens;
+  int size;
+  int capacity;
+} TokenArray;
+
+/* Function lexToken scans the next token of
+ * text[*pos..end) into *token, skipping blanks and
+ * comments, and advances *pos and *line past it.
+ * *lineStart is the offset where line *line begins
+ * and is kept up to date for the token's column.
+ * Returns FALSE if the end is reached first; *open
+ * then tells whether a comment is still open there.
+ * It uses no global state
+ */
+int lexToken(const char *text, int *pos, int end, int *line,
+             int *lineStart, Token *token, int *open);
+
+/* Function readSource reads the rest of the given
+ * file into a NUL-terminated buffer and stores its
+ * length in *length
+ */
+char *readSource(FILE *file, int *length);
+
+/* Procedure scanChunk appends the tokens of
+ * text[begin..end) to tokens. startLine is the line
+ * number of text[begin] and inComment tells whether
+ * text[begin] lies inside a comment. Returns TRUE if
+ * the chunk ends inside a comment
+ */
+int scanChunk(const char *text, int begin, int end,
+              int startLine, int inComment, TokenArray *tokens);
+
+/* Function scanBuffer tokenizes the whole buffer on
+ * the calling thread
+ */
+TokenArray *scanBuffer(const char *text, int length);
+
+/* Function scanParallel tokenizes the buffer with up
+ * to nthreads threads (0 = number of online CPUs).
+ * The buffer is split into chunks at newline
+ * boundaries; a comment-state pre-pass over every
+ * chunk decides whether the next chunk starts inside
+ * a comment, then the chunks are lexed concurrently
+ * and stitched together. The result is identical to
+ * the token sequence returned by getToken()
+ */
+TokenArray *scanParallel(const char *text, int length, int nthreads);
+
+void freeTokenArray(TokenArray *tokens);
+
+/* TokenRange describes the tokens replaced by an
+ * edit: old tokens [first, oldEnd) became the new
+ * tokens [first, newEnd). Tokens before first are
+ * untouched, the ones after are shifted
+ */
+typedef struct
+{
+  int first;
+  int oldEnd;
+  int newEnd;
+} TokenRange;
+
+/* Function relexTokens applies a text edit to the
+ * buffer of tokens: removed bytes at offset are
+ * replaced by inserted[0..insertedLength). Only the
+ * tokens from the last one ending before the edit up
+ * to the point where the token stream resynchronizes
+ * are re-lexed; the rest are shifted. The edited
+ * buffer is newly allocated, stored in tokens->text
+ * and returned; the old buffer still belongs to the
+ * caller. *changed (if not NULL) receives the range.
+ * Returns NULL and leaves the tokens alone if the
+ * edit does not lie within the buffer
+ */
+char *relexTokens(TokenArray *tokens, int offset, int removed,
+                  const char *inserted, int insertedLength,
+                  TokenRange *changed);
+
+/* Procedure tokenLexeme copies the lexeme of token t
+ * (truncated to MAXTOKENLEN like tokenString) into buf
+ */
+void tokenLexeme(const TokenArray *tokens, int t, char *buf);
+
+/* Procedure useTokenArray makes getToken() return
+ * the tokens of the given array instead of reading
+ * the source file. NULL switches back to the scanner
+ */
+void useTokenArray(TokenArray *tokens);
+
+/* Function nextArrayToken returns the next token of
+ * the array installed by useTokenArray, setting
+ * lineno and tokenString as the scanner does.
+ * Returns -1 if no array is installed
+ */
+TokenType nextArrayToken(void);
+
+/* arrayPosition returns the index of the token the
+ * next nextArrayToken() call returns, and
+ * seekTokenArray sets it
+ */
+int arrayPosition(void);
+void seekTokenArray(int t);
+
+/* Procedure skipBlock skips the tokens of a block
+ * whose LCURLY was just returned, by brace matching
+ * alone: the next token is the matching RCURLY, or
+ * ENDFILE if there is none
+ */
+void skipBlock(void);
+
+#endif
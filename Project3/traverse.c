@@ -0,0 +1,86 @@
+/****************************************************/
+/* File: traverse.c                                 */
+/* Non-recursive syntax tree traversal for the      */
+/* C-MINUS compiler                                 */
+/****************************************************/
+
+#include "globals.h"
+#include "traverse.h"
+
+/* a traversal this deep needs no heap memory */
+#define LOCAL_FRAMES 64
+
+/* A Frame is a node whose children are being
+ * visited; next is the next child to visit
+ */
+typedef struct
+{
+  TreeNode *node;
+  int next;
+} Frame;
+
+void traverse(TreeNode *t,
+              void (*preProc)(TreeNode *),
+              void (*postProc)(TreeNode *))
+{
+  Frame local[LOCAL_FRAMES];
+  Frame *stack = local;
+  int capacity = LOCAL_FRAMES;
+  int top = 0;
+
+  if (t == NULL)
+    return;
+  if (preProc != NULL)
+    preProc(t);
+  stack[0].node = t;
+  stack[0].next = 0;
+  while (top >= 0)
+  {
+    Frame *f = &stack[top];
+    if (f->next < MAXCHILDREN)
+    {
+      TreeNode *c = f->node->child[f->next++];
+      if (c == NULL)
+        continue;
+      if (preProc != NULL)
+        preProc(c);
+      if (++top == capacity)
+      {
+        Frame *grown = (Frame *)malloc(2 * capacity * sizeof(Frame));
+        if (grown == NULL)
+        {
+          fprintf(stderr, "Out of memory in tree traversal\n");
+          exit(1);
+        }
+        memcpy(grown, stack, capacity * sizeof(Frame));
+        if (stack != local)
+          free(stack);
+        stack = grown;
+        capacity *= 2;
+      }
+      stack[top].node = c;
+      stack[top].next = 0;
+    }
+    else
+    {
+      /* the next sibling takes the finished node's
+       * frame, so lists do not deepen the stack
+       */
+      TreeNode *s;
+      if (postProc != NULL)
+        postProc(f->node);
+      s = f->node->sibling;
+      if (s != NULL)
+      {
+        if (preProc != NULL)
+          preProc(s);
+        f->node = s;
+        f->next = 0;
+      }
+      else
+        top--;
+    }
+  }
+  if (stack != local)
+    free(stack);
+}
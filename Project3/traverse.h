@@ -0,0 +1,22 @@
+/****************************************************/
+/* File: traverse.h                                 */
+/* Non-recursive syntax tree traversal for the      */
+/* C-MINUS compiler                                 */
+/****************************************************/
+
+#ifndef _TRAVERSE_H_
+#define _TRAVERSE_H_
+
+/* Procedure traverse applies preProc in preorder and
+ * postProc in postorder to every node of the list
+ * starting at t: a node, then its children in order,
+ * then its next sibling. Either procedure may be
+ * NULL. Pending nodes are kept on an explicit stack
+ * that grows with the nesting depth of the tree, not
+ * with the length of sibling lists
+ */
+void traverse(TreeNode *t,
+              void (*preProc)(TreeNode *),
+              void (*postProc)(TreeNode *));
+
+#endif
@@ -8,6 +8,8 @@
 
 #include "globals.h"
 #include "util.h"
+#include "arena.h"
+#include "traverse.h"
 
 /* Procedure printToken prints a token
  * and its lexeme to the listing file
@@ -111,19 +113,18 @@ void printToken(TokenType token, const char *tokenString)
  */
 TreeNode *newTreeNode(NodeKind nodekind)
 {
-  TreeNode *t = (TreeNode *)malloc(sizeof(TreeNode));
-  int i;
-  if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
-  else
-  {
-    for (i = 0; i < MAXCHILDREN; i++)
-      t->child[i] = NULL;
-    t->sibling = NULL;
-    t->nodekind = nodekind; // parameter로 받은 nodeType에 따라 구분
-    t->lineno = lineno;
-    t->flag = FALSE;
-  }
+  return allocTreeNode(&astArena, nodekind);
+}
+
+/* Function allocTreeNode creates a new tree node
+ * in the given arena
+ */
+TreeNode *allocTreeNode(Arena *arena, NodeKind nodekind)
+{
+  TreeNode *t = (TreeNode *)arenaAlloc(arena, sizeof(TreeNode));
+  t->nodekind = nodekind; // parameter로 받은 nodeType에 따라 구분
+  t->lineno = lineno;
+  t->flag = FALSE;
   return t;
 }
 
@@ -132,23 +133,13 @@ TreeNode *newTreeNode(NodeKind nodekind)
  */
 char *copyString(char *s)
 {
-  int n;
-  char *t;
-  if (s == NULL)
-    return NULL;
-  n = strlen(s) + 1;
-  t = malloc(n);
-  if (t == NULL)
-    fprintf(listing, "Out of memory error at line %d\n", lineno);
-  else
-    strcpy(t, s);
-  return t;
+  return arenaCopyString(&astArena, s);
 }
 
 /* Variable indentno is used by printTree to
  * store current number of spaces to indent
  */
-static indentno = 0;
+static _Thread_local int indentno = 0;
 
 /* macros to increase/decrease indentation */
 #define INDENT indentno += 2
@@ -176,83 +167,96 @@ char *find_type(NodeType type)
     return "<Type Error>";
 }
 
-/* procedure printTree prints a syntax tree to the
- * listing file using indentation to indicate subtrees
+/* procedure printNode prints the description of
+ * a single tree node (without indentation)
  */
-void printTree(TreeNode *tree)
+void printNode(TreeNode *tree)
 {
-  int i;
-  INDENT;
-  while (tree != NULL)
+  switch (tree->nodekind)
   {
-    printSpaces();
-    switch (tree->nodekind)
-    {
-    case VarDeclK:
-      fprintf(listing, "Variable Declaration: name = %s, type = %s\n", tree->name, find_type(tree->type));
-      break;
+  case VarDeclK:
+    fprintf(listing, "Variable Declaration: name = %s, type = %s\n", tree->name, find_type(tree->type));
+    break;
 
-    case FunDeclK:
-      fprintf(listing, "Function Declaration: name = %s, return type = %s\n", tree->name, find_type(tree->type));
-      break;
+  case FunDeclK:
+    fprintf(listing, "Function Declaration: name = %s, return type = %s\n", tree->name, find_type(tree->type));
+    break;
 
-    case ParamK:
-      if (tree->type == Void)
-        fprintf(listing, "Void Parameter\n");
-      else
-        fprintf(listing, "Parameter: name = %s, type = %s\n", tree->name, find_type(tree->type));
-      break;
+  case ParamK:
+    if (tree->type == Void)
+      fprintf(listing, "Void Parameter\n");
+    else
+      fprintf(listing, "Parameter: name = %s, type = %s\n", tree->name, find_type(tree->type));
+    break;
 
-    case CompStmtK:
-      fprintf(listing, "Compound Statement:\n");
-      break;
+  case CompStmtK:
+    fprintf(listing, "Compound Statement:\n");
+    break;
 
-    case SelectStmtK:
-      if (tree->flag)
-        fprintf(listing, "If-Else Statement:\n");
-      else
-        fprintf(listing, "If Statement:\n");
-      break;
+  case SelectStmtK:
+    if (tree->flag)
+      fprintf(listing, "If-Else Statement:\n");
+    else
+      fprintf(listing, "If Statement:\n");
+    break;
 
-    case IterStmtK:
-      fprintf(listing, "While Statement:\n");
-      break;
+  case IterStmtK:
+    fprintf(listing, "While Statement:\n");
+    break;
 
-    case RetStmtK:
-      if (tree->flag)
-        fprintf(listing, "Non-value Return Statement\n");
-      else
-        fprintf(listing, "Return Statement:\n");
-      break;
+  case RetStmtK:
+    if (tree->flag)
+      fprintf(listing, "Non-value Return Statement\n");
+    else
+      fprintf(listing, "Return Statement:\n");
+    break;
 
-    case OpK:
-      fprintf(listing, "Op: ");
-      printToken(tree->op, "\0");
-      break;
+  case OpK:
+    fprintf(listing, "Op: ");
+    printToken(tree->op, "\0");
+    break;
 
-    case AssignK:
-      fprintf(listing, "Assign:\n");
-      break;
+  case AssignK:
+    fprintf(listing, "Assign:\n");
+    break;
 
-    case VarExpK:
-      fprintf(listing, "Variable: name = %s\n", tree->name);
-      break;
+  case VarExpK:
+    fprintf(listing, "Variable: name = %s\n", tree->name);
+    break;
 
-    case ConstK:
-      fprintf(listing, "Const: %d\n", tree->val);
-      break;
+  case ConstK:
+    fprintf(listing, "Const: %d\n", tree->val);
+    break;
 
-    case CallK:
-      fprintf(listing, "Call: function name = %s\n", tree->name);
-      break;
+  case CallK:
+    fprintf(listing, "Call: function name = %s\n", tree->name);
+    break;
 
-    default:
-      fprintf(listing, "Unknown Node kind\n");
-      break;
-    }
-    for (i = 0; i < MAXCHILDREN; i++)
-      printTree(tree->child[i]);
-    tree = tree->sibling;
+  default:
+    fprintf(listing, "Unknown Node kind\n");
+    break;
   }
+}
+
+/* procedure printTree prints a syntax tree to the
+ * listing file using indentation to indicate subtrees
+ */
+static void printPre(TreeNode *tree)
+{
+  printSpaces();
+  printNode(tree);
+  INDENT;
+}
+
+static void printPost(TreeNode *tree)
+{
+  (void)tree;
+  UNINDENT;
+}
+
+void printTree(TreeNode *tree)
+{
+  INDENT;
+  traverse(tree, printPre, printPost);
   UNINDENT;
 }
@@ -13,9 +13,17 @@
  */
 void printToken(TokenType, const char *);
 
+#include "arena.h"
+
 // newStmtNode와 newExpNode를 통합한 newTreeNode
+// (allocated in astArena)
 TreeNode *newTreeNode(NodeKind);
 
+/* Function allocTreeNode creates a new tree
+ * node in the given arena
+ */
+TreeNode *allocTreeNode(Arena *, NodeKind);
+
 /* Function newStmtNode creates a new statement
  * node for syntax tree construction
  */
@@ -27,10 +35,15 @@ TreeNode *newTreeNode(NodeKind);
 // TreeNode * newExpNode(ExpKind);
 
 /* Function copyString allocates and makes a new
- * copy of an existing string
+ * copy of an existing string (in astArena)
  */
 char *copyString(char *);
 
+/* procedure printNode prints the description of
+ * a single tree node (without indentation)
+ */
+void printNode(TreeNode *);
+
 /* procedure printTree prints a syntax tree to the
  * listing file using indentation to indicate subtrees
  */
@@ -0,0 +1,129 @@
+/****************************************************/
+/* File: xref.c                                     */
+/* Cross-reference positions for the C-MINUS compiler   */
+/****************************************************/
+
+#include "globals.h"
+#include "symtab.h"
+#include "xref.h"
+
+/* XrefPos is a definition or use and its entry */
+typedef struct
+{
+  SourcePos pos;
+  BucketList entry;
+} XrefPos;
+
+/* all positions, sorted by line and column */
+static _Thread_local XrefPos *positions = NULL;
+static _Thread_local int positionCount = 0;
+
+static int comparePos(const void *a, const void *b)
+{
+  const SourcePos *p = &((const XrefPos *)a)->pos;
+  const SourcePos *q = &((const XrefPos *)b)->pos;
+  if (p->lineno != q->lineno)
+    return p->lineno < q->lineno ? -1 : 1;
+  return p->column < q->column ? -1 : p->column > q->column;
+}
+
+static void buildIndex(void)
+{
+  int i, n = 0;
+  BucketList l;
+  LineList chunk;
+
+  for (i = 0; i < scope_count(); i++)
+    for (l = get_scope(i)->entries; l != NULL; l = l->next)
+      n += 1 + l->useCount;
+  positions = (XrefPos *)malloc((n > 0 ? n : 1) * sizeof(XrefPos));
+  if (positions == NULL)
+  {
+    fprintf(stderr, "Out of memory in cross-reference positions\n");
+    exit(1);
+  }
+  for (i = 0; i < scope_count(); i++)
+    for (l = get_scope(i)->entries; l != NULL; l = l->next)
+    {
+      int k;
+      positions[positionCount].pos = l->defined;
+      positions[positionCount++].entry = l;
+      for (chunk = l->uses; chunk != NULL; chunk = chunk->next)
+        for (k = 0; k < chunk->count; k++)
+        {
+          positions[positionCount].pos = chunk->pos[k];
+          positions[positionCount++].entry = l;
+        }
+    }
+  qsort(positions, positionCount, sizeof(XrefPos), comparePos);
+}
+
+BucketList xrefSymbolAt(int lineno, int column)
+{
+  XrefPos key;
+  XrefPos *found;
+
+  if (positions == NULL)
+    buildIndex();
+  key.pos.lineno = lineno;
+  key.pos.column = column;
+  found = (XrefPos *)bsearch(&key, positions, positionCount, sizeof(XrefPos), comparePos);
+  return found != NULL ? found->entry : NULL;
+}
+
+int xrefFind(char *name, BucketList *found, int max)
+{
+  int i, n = 0;
+  BucketList l;
+
+  for (i = 0; i < scope_count(); i++)
+    for (l = get_scope(i)->entries; l != NULL; l = l->next)
+      if (l->name == name)
+      {
+        if (n < max)
+          found[n] = l;
+        n++;
+      }
+  return n;
+}
+
+SourcePos xrefUse(BucketList l, int i)
+{
+  LineList chunk = l->uses;
+  while (i >= chunk->count)
+  {
+    i -= chunk->count;
+    chunk = chunk->next;
+  }
+  return chunk->pos[i];
+}
+
+void printXref(FILE *listing)
+{
+  int i;
+  BucketList l;
+  LineList chunk;
+
+  fprintf(listing, "< Cross Reference >\n");
+  for (i = 0; i < scope_count(); i++)
+  {
+    ScopeList scope = get_scope(i);
+    for (l = scope->entries; l != NULL; l = l->next)
+    {
+      int k;
+      fprintf(listing, "%s %s %d:%d %d", l->name, scope->name,
+              l->defined.lineno, l->defined.column, l->useCount);
+      for (chunk = l->uses; chunk != NULL; chunk = chunk->next)
+        for (k = 0; k < chunk->count; k++)
+          fprintf(listing, " %d:%d", chunk->pos[k].lineno, chunk->pos[k].column);
+      fprintf(listing, "\n");
+    }
+  }
+}
+
+void freeXref(void)
+{
+  free(positions);
+  positions = NULL;
+  positionCount = 0;
+}
@@ -0,0 +1,43 @@
+/****************************************************/
+/* File: xref.h                                     */
+/* Cross-reference index for the C-MINUS compiler   */
+/****************************************************/
+
+#ifndef _XREF_H_
+#define _XREF_H_
+
+#include "symtab.h"
+
+/* The index covers the symbol table built with
+ * xrefIndex set: each entry's definition and its
+ * uses (see st_add_use), with line and column
+ */
+
+/* Function xrefSymbolAt returns the entry defined or
+ * used at lineno:column, or NULL. The first query
+ * sorts all positions; the others are binary searches
+ */
+BucketList xrefSymbolAt(int lineno, int column);
+
+/* Function xrefFind stores in found[0..max) the
+ * entries named name, in order of their scopes, and
+ * returns how many there are
+ */
+int xrefFind(char *name, BucketList *found, int max);
+
+/* Function xrefUse returns the i-th use of l,
+ * 0 <= i < l->useCount
+ */
+SourcePos xrefUse(BucketList l, int i);
+
+/* Procedure printXref writes the index, one line per
+ * entry, scope by scope:
+ *   name scope line:column uses line:column ...
+ * where uses is the number of uses that follow
+ */
+void printXref(FILE *listing);
+
+/* Procedure freeXref releases the position index */
+void freeXref(void);
+
+#endif